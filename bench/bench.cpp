@@ -0,0 +1,524 @@
+/**
+ * @author NoxFly
+ *
+ * Benchmark suite : for every .frag of res/shaders/, times the preprocessing,
+ * the compilation and the link of the program, then the frames at several resolutions.
+ * Runs headless. Must be launched from the bin/ folder, like the application.
+ *
+ * With --baseline / --check, it is also the performance gate (see perfGate.hpp).
+ */
+
+#include "App.hpp"
+#include "utils.hpp"
+#include "preprocessor.hpp"
+#include "perfGate.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+struct resolution {
+	unsigned int width;
+	unsigned int height;
+};
+
+struct benchOptions {
+	unsigned int warmup = 10;
+	unsigned int frames = 100;
+	unsigned int repetitions = 5;
+	std::vector<resolution> resolutions{ { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+	std::string format = "json";
+	std::string outputPath;
+	std::string filter;
+	bool driverCache = false;
+	bool software = false;		// Mesa llvmpipe with a fixed thread count, the same on every machine
+	std::string baselinePath;	// records the samples and the frame checksums
+	std::string checkPath;		// compares against them, fails on regression
+	gateOptions gate;
+};
+
+struct resolutionResult {
+	resolution size;
+	statsSummary cpu;	// ms per frame (wall clock, including the final glFinish), one sample per repetition
+	statsSummary gpu;	// mean GPU ms per frame, one sample per repetition
+};
+
+struct shaderResult {
+	std::string name;
+	bool ok = false;
+	statsSummary preprocess;
+	statsSummary compile;
+	statsSummary link;
+	std::vector<resolutionResult> resolutions;
+	gateShader gate;	// raw samples and checksums
+};
+
+using benchClock = std::chrono::steady_clock;
+
+static double elapsedMs(benchClock::time_point from, benchClock::time_point to) {
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// llvmpipe threads of --software : fixed, so the gate does not depend on the core count
+#define SOFTWARE_THREADS "4"
+
+static void setEnv(const char* name, const char* value) {
+#ifdef _WIN32
+	_putenv_s(name, value);
+#else
+	setenv(name, value, 0);
+#endif
+}
+
+static void printBenchUsage(const char* program) {
+	std::cout << "Usage: " << program << " [options]\n\n"
+		<< "  --warmup <n>           Frames rendered before measuring (default 10).\n"
+		<< "  --frames <n>           Measured frames per repetition (default 100).\n"
+		<< "  --reps <n>             Repetitions of every measure (default 5).\n"
+		<< "  --resolutions <list>   Comma separated list of <w>x<h> (default 1280x720,1920x1080,3840x2160).\n"
+		<< "  --filter <text>        Only benchmark the shaders whose name contains this text.\n"
+		<< "  --format <json|csv>    Output format (default json).\n"
+		<< "  --output <file>        Output file (default stdout).\n"
+		<< "  --driver-cache         Keep the driver's shader disk cache enabled (compile times become cache hits).\n"
+		<< "  --software             Render with Mesa llvmpipe on " << SOFTWARE_THREADS << " threads, for comparable runs on any machine.\n"
+		<< "  --baseline <file>      Record the samples and a checksum of the frames, to check later runs against.\n"
+		<< "  --check <file>         Compare against a baseline : fails on a significant slowdown or a changed image.\n"
+		<< "  --threshold <percent>  Slowdown of the median tolerated by --check (default 10).\n"
+		<< "  --alpha <p>            Significance level of the Mann-Whitney test of --check (default 0.01).\n"
+		<< std::endl;
+}
+
+static bool parseBenchOptions(int argc, char** argv, benchOptions& opts) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--warmup" && hasValue) {
+			opts.warmup = (unsigned int)std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--frames" && hasValue) {
+			opts.frames = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--reps" && hasValue) {
+			opts.repetitions = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--resolutions" && hasValue) {
+			std::stringstream list(argv[++i]);
+			std::string item;
+
+			opts.resolutions.clear();
+
+			while (std::getline(list, item, ',')) {
+				const size_t x = item.find('x');
+				const int w = x != std::string::npos ? std::atoi(item.substr(0, x).c_str()) : 0;
+				const int h = x != std::string::npos ? std::atoi(item.substr(x + 1).c_str()) : 0;
+
+				if (w <= 0 || h <= 0) {
+					std::cerr << "Invalid resolution \"" << item << "\"" << std::endl;
+					return false;
+				}
+
+				opts.resolutions.push_back({ (unsigned int)w, (unsigned int)h });
+			}
+		}
+		else if (arg == "--filter" && hasValue) {
+			opts.filter = argv[++i];
+		}
+		else if (arg == "--format" && hasValue) {
+			opts.format = argv[++i];
+
+			if (opts.format != "json" && opts.format != "csv") {
+				std::cerr << "Unknown format \"" << opts.format << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--output" && hasValue) {
+			opts.outputPath = argv[++i];
+		}
+		else if (arg == "--driver-cache") {
+			opts.driverCache = true;
+		}
+		else if (arg == "--software") {
+			opts.software = true;
+		}
+		else if (arg == "--baseline" && hasValue) {
+			opts.baselinePath = argv[++i];
+		}
+		else if (arg == "--check" && hasValue) {
+			opts.checkPath = argv[++i];
+		}
+		else if (arg == "--threshold" && hasValue) {
+			opts.gate.threshold = std::max(0.0, std::atof(argv[++i]) / 100.0);
+		}
+		else if (arg == "--alpha" && hasValue) {
+			opts.gate.alpha = std::atof(argv[++i]);
+
+			if (opts.gate.alpha <= 0 || opts.gate.alpha >= 1) {
+				std::cerr << "Invalid significance level \"" << argv[i] << "\"" << std::endl;
+				return false;
+			}
+		}
+		else {
+			return false;
+		}
+	}
+
+	return !opts.resolutions.empty();
+}
+
+/**
+ * Every .frag of res/shaders/, as names usable by loadShader (relative path, no extension).
+ */
+static std::vector<std::string> findShaders(const std::string& filter) {
+	namespace fs = std::filesystem;
+
+	std::vector<std::string> names;
+	std::error_code ec;
+
+	for (auto it = fs::recursive_directory_iterator("res/shaders", ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+		if (ec || !it->is_regular_file() || it->path().extension() != ".frag") {
+			continue;
+		}
+
+		std::string name = fs::relative(it->path(), "res/shaders").replace_extension().generic_string();
+
+		if (filter.empty() || name.find(filter) != std::string::npos) {
+			names.push_back(name);
+		}
+	}
+
+	std::sort(names.begin(), names.end());
+
+	return names;
+}
+
+/**
+ * Times preprocessing, compilation and link, each repetition from scratch.
+ */
+static bool benchPipeline(const std::string& name, unsigned int repetitions, shaderResult& result) {
+	rollingStats preprocess, compile, link;
+
+	for (unsigned int rep = 0; rep < repetitions; rep++) {
+		shader program{};
+		std::string vertexSource, fragmentSource;
+
+		// cold preprocessing : every file is read again
+		clearPreprocessorCache();
+
+		const auto t0 = benchClock::now();
+
+		if (!buildShaderSource("FRAGMENT", name, fragmentSource)) {
+			return false;
+		}
+
+		const auto t1 = benchClock::now();
+
+		buildShaderSource("VERTEX", name, vertexSource);
+
+		// the compile status query waits for the driver, so the compilation is really over
+		if (!compileShaderSource(program.vertexId, "VERTEX", vertexSource)
+			|| !compileShaderSource(program.fragmentId, "FRAGMENT", fragmentSource))
+		{
+			deleteShader(program);
+			return false;
+		}
+
+		const auto t2 = benchClock::now();
+
+		if (!linkShader(program)) {
+			return false;
+		}
+
+		const auto t3 = benchClock::now();
+
+		deleteShader(program);
+
+		pushSample(preprocess, elapsedMs(t0, t1), repetitions);
+		pushSample(compile, elapsedMs(t1, t2), repetitions);
+		pushSample(link, elapsedMs(t2, t3), repetitions);
+	}
+
+	result.preprocess = summarize(preprocess);
+	result.compile = summarize(compile);
+	result.link = summarize(link);
+
+	result.gate.metrics.push_back({ "preprocess", preprocess.samples });
+	result.gate.metrics.push_back({ "compile", compile.samples });
+	result.gate.metrics.push_back({ "link", link.samples });
+
+	return true;
+}
+
+/**
+ * Hash of the offscreen framebuffer : every repetition renders the same frames at the same times,
+ * so the last one only changes when the output of the shader does.
+ */
+static uint64_t hashFrame(const resolution& size) {
+	std::vector<unsigned char> pixels((size_t)size.width * size.height * 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glReadPixels(0, 0, size.width, size.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	return hash64(std::string_view((const char*)pixels.data(), pixels.size()));
+}
+
+static void benchFrames(App& app, const benchOptions& opts, shaderResult& result) {
+	const double dt = 1.0 / 60.0;
+
+	for (const resolution& size : opts.resolutions) {
+		if (!app.setOffscreenSize(size.width, size.height)) {
+			std::cerr << "  cannot render at " << size.width << "x" << size.height << std::endl;
+			continue;
+		}
+
+		rollingStats cpu, gpu;
+		std::vector<double> gpuFrames;
+
+		for (unsigned int rep = 0; rep < opts.repetitions; rep++) {
+			for (unsigned int i = 0; i < opts.warmup; i++) {
+				app.renderOffscreenFrame(i * dt, dt);
+			}
+
+			app.flushFrameStats();
+			app.clearFrameStats();
+
+			const auto start = benchClock::now();
+
+			// same fixed timestep for every repetition, so they all render the same frames
+			for (unsigned int i = 0; i < opts.frames; i++) {
+				app.renderOffscreenFrame(i * dt, dt);
+			}
+
+			app.flushFrameStats();
+
+			const auto end = benchClock::now();
+
+			pushSample(cpu, elapsedMs(start, end) / opts.frames, opts.repetitions);
+			pushSample(gpu, summarize(app.getFrameStats().gpu).mean, opts.repetitions);
+
+			const std::vector<double>& frames = app.getFrameStats().gpu.samples;
+			gpuFrames.insert(gpuFrames.end(), frames.begin(), frames.end());
+		}
+
+		result.resolutions.push_back({ size, summarize(cpu), summarize(gpu) });
+
+		const std::string suffix = "@" + std::to_string(size.width) + "x" + std::to_string(size.height);
+
+		result.gate.metrics.push_back({ "frame_cpu" + suffix, cpu.samples });
+		result.gate.metrics.push_back({ "frame_gpu" + suffix, gpuFrames });
+		result.gate.checksums.push_back({ suffix.substr(1), hashFrame(size) });
+	}
+}
+
+
+static void writeJsonStats(std::ostream& out, const statsSummary& s) {
+	out << "{ \"mean\": " << s.mean
+		<< ", \"stddev\": " << s.stddev
+		<< ", \"min\": " << s.min
+		<< ", \"median\": " << s.p50
+		<< ", \"max\": " << s.max
+		<< " }";
+}
+
+static void writeJson(std::ostream& out, const benchOptions& opts, const std::vector<shaderResult>& results) {
+	out << std::fixed << std::setprecision(4)
+		<< "{\n"
+		<< "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+		<< "  \"version\": \"" << glGetString(GL_VERSION) << "\",\n"
+		<< "  \"warmup\": " << opts.warmup << ",\n"
+		<< "  \"frames\": " << opts.frames << ",\n"
+		<< "  \"repetitions\": " << opts.repetitions << ",\n"
+		<< "  \"shaders\": [";
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const shaderResult& r = results[i];
+
+		out << (i > 0 ? "," : "") << "\n    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"ok\": " << (r.ok ? "true" : "false");
+
+		if (r.ok) {
+			out << ",\n      \"preprocess_ms\": ";
+			writeJsonStats(out, r.preprocess);
+			out << ",\n      \"compile_ms\": ";
+			writeJsonStats(out, r.compile);
+			out << ",\n      \"link_ms\": ";
+			writeJsonStats(out, r.link);
+			out << ",\n      \"frames\": [";
+
+			for (size_t j = 0; j < r.resolutions.size(); j++) {
+				const resolutionResult& f = r.resolutions[j];
+				const double mpixels = f.cpu.mean > 0 ? f.size.width * f.size.height / (f.cpu.mean * 1000.0) : 0;
+
+				out << (j > 0 ? "," : "") << "\n        { \"width\": " << f.size.width
+					<< ", \"height\": " << f.size.height
+					<< ", \"mpixels_per_s\": " << mpixels
+					<< ",\n          \"cpu_ms\": ";
+				writeJsonStats(out, f.cpu);
+				out << ",\n          \"gpu_ms\": ";
+				writeJsonStats(out, f.gpu);
+				out << " }";
+			}
+
+			out << "\n      ]";
+		}
+
+		out << "\n    }";
+	}
+
+	out << "\n  ]\n}" << std::endl;
+}
+
+static void writeCsvLine(std::ostream& out, const std::string& name, const char* metric, unsigned int w, unsigned int h, const statsSummary& s) {
+	out << name << "," << metric << "," << w << "," << h << ","
+		<< s.mean << "," << s.stddev << "," << s.min << "," << s.p50 << "," << s.max << "," << s.count << "\n";
+}
+
+static void writeCsv(std::ostream& out, const std::vector<shaderResult>& results) {
+	out << std::fixed << std::setprecision(4)
+		<< "shader,metric,width,height,mean_ms,stddev_ms,min_ms,median_ms,max_ms,repetitions\n";
+
+	for (const shaderResult& r : results) {
+		if (!r.ok) {
+			out << r.name << ",error,0,0,,,,,,0\n";
+			continue;
+		}
+
+		writeCsvLine(out, r.name, "preprocess", 0, 0, r.preprocess);
+		writeCsvLine(out, r.name, "compile", 0, 0, r.compile);
+		writeCsvLine(out, r.name, "link", 0, 0, r.link);
+
+		for (const resolutionResult& f : r.resolutions) {
+			writeCsvLine(out, r.name, "frame_cpu", f.size.width, f.size.height, f.cpu);
+			writeCsvLine(out, r.name, "frame_gpu", f.size.width, f.size.height, f.gpu);
+		}
+	}
+
+	out.flush();
+}
+
+/**
+ * What the samples and the checksums depend on, besides the renderer.
+ */
+static std::string gateConfig(const benchOptions& opts) {
+	std::string config = "warmup=" + std::to_string(opts.warmup)
+		+ " frames=" + std::to_string(opts.frames)
+		+ " reps=" + std::to_string(opts.repetitions)
+		+ " resolutions=";
+
+	for (size_t i = 0; i < opts.resolutions.size(); i++) {
+		config += (i > 0 ? "," : "") + std::to_string(opts.resolutions[i].width) + "x" + std::to_string(opts.resolutions[i].height);
+	}
+
+	return config;
+}
+
+
+int main(int argc, char** argv)
+{
+	benchOptions opts;
+
+	if (!parseBenchOptions(argc, argv, opts)) {
+		printBenchUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// the driver's disk cache would turn every compilation after the first run into a lookup
+	if (!opts.driverCache) {
+		setEnv("MESA_SHADER_CACHE_DISABLE", "true");
+		setEnv("__GL_SHADER_DISK_CACHE", "0");
+	}
+
+	if (opts.software) {
+		setEnv("LIBGL_ALWAYS_SOFTWARE", "1");
+		setEnv("GALLIUM_DRIVER", "llvmpipe");
+		setEnv("LP_NUM_THREADS", SOFTWARE_THREADS);
+	}
+
+	gateRun baseline;
+
+	// before the whole run : a missing baseline fails right away
+	if (!opts.checkPath.empty() && !readBaseline(opts.checkPath, baseline)) {
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<std::string> shaders = findShaders(opts.filter);
+
+	if (shaders.empty()) {
+		std::cerr << "No shader found in res/shaders/. Run the benchmark from the bin/ folder." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	options appOptions;
+	appOptions.headless = true;
+	appOptions.width = opts.resolutions.front().width;
+	appOptions.height = opts.resolutions.front().height;
+
+	App app(appOptions);
+
+	std::vector<shaderResult> results;
+
+	for (const std::string& name : shaders) {
+		std::cerr << "[Bench] " << name << std::endl;
+
+		shaderResult result;
+		result.name = name;
+		result.ok = benchPipeline(name, opts.repetitions, result) && app.loadFractal(name);
+
+		if (result.ok) {
+			benchFrames(app, opts, result);
+		}
+
+		results.push_back(result);
+	}
+
+	std::ofstream file;
+
+	if (!opts.outputPath.empty()) {
+		file.open(opts.outputPath);
+
+		if (!file.is_open()) {
+			std::cerr << "Cannot open " << opts.outputPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::ostream& out = file.is_open() ? file : std::cout;
+
+	// the report is only printed when asked for, or when there is nothing else to do
+	if (file.is_open() || (opts.baselinePath.empty() && opts.checkPath.empty())) {
+		if (opts.format == "csv") {
+			writeCsv(out, results);
+		}
+		else {
+			writeJson(out, opts, results);
+		}
+	}
+
+	gateRun run;
+	run.renderer = (const char*)glGetString(GL_RENDERER);
+	run.config = gateConfig(opts);
+
+	for (const shaderResult& result : results) {
+		run.shaders.push_back(result.gate);
+		run.shaders.back().name = result.name;
+		run.shaders.back().ok = result.ok;
+	}
+
+	if (!opts.baselinePath.empty()) {
+		if (!writeBaseline(opts.baselinePath, run)) {
+			return EXIT_FAILURE;
+		}
+
+		std::cerr << "[Gate] Baseline of " << run.shaders.size() << " shaders written to " << opts.baselinePath << std::endl;
+	}
+
+	if (!opts.checkPath.empty() && !checkBaseline(baseline, run, opts.gate, std::cout)) {
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
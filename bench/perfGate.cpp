@@ -0,0 +1,332 @@
+/**
+ * @author NoxFly
+ */
+
+#include "perfGate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+bool writeBaseline(const std::string& path, const gateRun& run) {
+	std::ofstream file(path);
+
+	if (!file.is_open()) {
+		std::cerr << "[Gate] Cannot write " << path << std::endl;
+		return false;
+	}
+
+	file << "# ShaderPlayground performance baseline, written by ShaderPlaygroundBench --baseline\n"
+		<< "renderer " << run.renderer << "\n"
+		<< "config " << run.config << "\n"
+		<< std::setprecision(9);
+
+	for (const gateShader& shader : run.shaders) {
+		file << "shader " << shader.name << " " << (shader.ok ? "ok" : "failed") << "\n";
+
+		for (const auto& [name, samples] : shader.metrics) {
+			file << "metric " << name;
+
+			for (const double sample : samples) {
+				file << " " << sample;
+			}
+
+			file << "\n";
+		}
+
+		for (const auto& [size, checksum] : shader.checksums) {
+			file << "checksum " << size << " " << std::hex << std::setw(16) << std::setfill('0') << checksum
+				<< std::dec << std::setfill(' ') << "\n";
+		}
+	}
+
+	if (!file) {
+		std::cerr << "[Gate] Cannot write " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool readBaseline(const std::string& path, gateRun& run) {
+	std::ifstream file(path);
+
+	if (!file.is_open()) {
+		std::cerr << "[Gate] No baseline at " << path << ", record one with --baseline " << path << std::endl;
+		return false;
+	}
+
+	run = {};
+
+	std::string line;
+	unsigned int number = 0;
+
+	while (std::getline(file, line)) {
+		number++;
+
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream stream(line);
+		std::string key;
+
+		stream >> key;
+
+		if (key == "renderer" || key == "config") {
+			std::string value;
+			std::getline(stream >> std::ws, value);
+			(key == "renderer" ? run.renderer : run.config) = value;
+		}
+		else if (key == "shader") {
+			gateShader shader;
+			std::string status;
+
+			stream >> shader.name >> status;
+			shader.ok = status == "ok";
+
+			run.shaders.push_back(shader);
+		}
+		else if ((key == "metric" || key == "checksum") && !run.shaders.empty()) {
+			std::string name;
+			stream >> name;
+
+			if (key == "checksum") {
+				uint64_t checksum = 0;
+				stream >> std::hex >> checksum;
+				run.shaders.back().checksums.push_back({ name, checksum });
+			}
+			else {
+				std::vector<double> samples;
+				double sample;
+
+				while (stream >> sample) {
+					samples.push_back(sample);
+				}
+
+				run.shaders.back().metrics.push_back({ name, samples });
+			}
+		}
+		else {
+			std::cerr << "[Gate] " << path << ":" << number << " : unexpected line" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static double median(std::vector<double> samples) {
+	if (samples.empty()) {
+		return 0;
+	}
+
+	const size_t middle = samples.size() / 2;
+	std::nth_element(samples.begin(), samples.begin() + middle, samples.end());
+
+	if (samples.size() % 2 == 1) {
+		return samples[middle];
+	}
+
+	return (samples[middle] + *std::max_element(samples.begin(), samples.begin() + middle)) / 2;
+}
+
+double mannWhitneyGreater(const std::vector<double>& current, const std::vector<double>& baseline) {
+	const size_t n1 = current.size();
+	const size_t n2 = baseline.size();
+
+	if (n1 == 0 || n2 == 0) {
+		return 1;
+	}
+
+	// ranks in the pooled samples, tied values share their average rank
+	std::vector<std::pair<double, bool>> pooled;
+	pooled.reserve(n1 + n2);
+
+	for (const double v : current) pooled.push_back({ v, true });
+	for (const double v : baseline) pooled.push_back({ v, false });
+
+	std::sort(pooled.begin(), pooled.end(), [](const auto& a, const auto& b) {
+		return a.first < b.first;
+	});
+
+	const double n = (double)(n1 + n2);
+	double rankSum = 0;
+	double ties = 0;
+
+	for (size_t i = 0; i < pooled.size();) {
+		size_t j = i;
+
+		while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+			j++;
+		}
+
+		const double rank = (i + 1 + j) / 2.0;
+		const double t = (double)(j - i);
+
+		for (size_t k = i; k < j; k++) {
+			if (pooled[k].second) {
+				rankSum += rank;
+			}
+		}
+
+		ties += t * t * t - t;
+		i = j;
+	}
+
+	// pairs (current, baseline) where current is the slowest, ties counting half
+	const double u = rankSum - n1 * (n1 + 1) / 2.0;
+
+	if (n1 * n2 <= GATE_EXACT_LIMIT) {
+		// count[j][v] : orderings of i current and j baseline samples with U = v.
+		// The largest value is either a current one, above the j baseline ones, or a baseline one.
+		const size_t maxU = n1 * n2;
+		std::vector<std::vector<double>> count(n2 + 1, std::vector<double>(maxU + 1, 0));
+
+		for (size_t j = 0; j <= n2; j++) {
+			count[j][0] = 1;
+		}
+
+		for (size_t i = 1; i <= n1; i++) {
+			std::vector<std::vector<double>> next(n2 + 1, std::vector<double>(maxU + 1, 0));
+			next[0][0] = 1;
+
+			for (size_t j = 1; j <= n2; j++) {
+				for (size_t v = 0; v <= maxU; v++) {
+					next[j][v] = (v >= j ? count[j][v - j] : 0) + next[j - 1][v];
+				}
+			}
+
+			count.swap(next);
+		}
+
+		double total = 0;
+		double tail = 0;
+
+		// a half U from ties rounds down : the test stays conservative
+		const size_t from = (size_t)std::floor(u);
+
+		for (size_t v = 0; v <= maxU; v++) {
+			total += count[n2][v];
+
+			if (v >= from) {
+				tail += count[n2][v];
+			}
+		}
+
+		return tail / total;
+	}
+
+	const double mean = n1 * n2 / 2.0;
+	const double variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)));
+
+	if (variance <= 0) {
+		return 1;
+	}
+
+	const double z = (u - mean - 0.5) / std::sqrt(variance);
+
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+bool checkBaseline(const gateRun& baseline, const gateRun& current, const gateOptions& opts, std::ostream& out) {
+	if (baseline.renderer != current.renderer) {
+		out << "[Gate] The baseline was recorded on \"" << baseline.renderer << "\", this is \"" << current.renderer
+			<< "\" : timings and images do not compare, record it again" << std::endl;
+		return false;
+	}
+
+	if (baseline.config != current.config) {
+		out << "[Gate] The baseline was recorded with \"" << baseline.config << "\", this run is \"" << current.config
+			<< "\" : use the same options" << std::endl;
+		return false;
+	}
+
+	bool passed = true;
+	unsigned int regressions = 0, changed = 0, improvements = 0;
+
+	out << std::left << std::setw(28) << "shader" << std::setw(22) << "metric" << std::right
+		<< std::setw(11) << "base ms" << std::setw(11) << "now ms" << std::setw(9) << "change" << std::setw(10) << "p"
+		<< "\n" << std::fixed;
+
+	for (const gateShader& before : baseline.shaders) {
+		auto it = std::find_if(current.shaders.begin(), current.shaders.end(), [&](const gateShader& s) {
+			return s.name == before.name;
+		});
+
+		if (it == current.shaders.end()) {
+			// --filter, or a removed shader
+			continue;
+		}
+
+		const gateShader& now = *it;
+
+		if (before.ok && !now.ok) {
+			out << std::left << std::setw(28) << now.name << "FAILED (worked in the baseline)\n";
+			passed = false;
+			continue;
+		}
+
+		if (!before.ok || !now.ok) {
+			continue;
+		}
+
+		for (const auto& [name, samples] : before.metrics) {
+			auto metric = std::find_if(now.metrics.begin(), now.metrics.end(), [&](const auto& m) {
+				return m.first == name;
+			});
+
+			if (metric == now.metrics.end()) {
+				continue;
+			}
+
+			const double base = median(samples);
+			const double value = median(metric->second);
+			const double change = base > 0 ? value / base - 1 : 0;
+			const bool significant = std::abs(value - base) > GATE_MIN_DELTA_MS && std::abs(change) > opts.threshold;
+
+			const double slower = mannWhitneyGreater(metric->second, samples);
+			const double faster = mannWhitneyGreater(samples, metric->second);
+
+			const char* verdict = "";
+
+			if (significant && change > 0 && slower < opts.alpha) {
+				verdict = "  REGRESSION";
+				regressions++;
+				passed = false;
+			}
+			else if (significant && change < 0 && faster < opts.alpha) {
+				verdict = "  faster";
+				improvements++;
+			}
+
+			out << std::left << std::setw(28) << now.name << std::setw(22) << name << std::right
+				<< std::setprecision(3) << std::setw(11) << base << std::setw(11) << value
+				<< std::setprecision(1) << std::setw(8) << change * 100 << "%"
+				<< std::setprecision(4) << std::setw(10) << (change > 0 ? slower : faster)
+				<< verdict << "\n";
+		}
+
+		for (const auto& [size, checksum] : before.checksums) {
+			auto image = std::find_if(now.checksums.begin(), now.checksums.end(), [&](const auto& c) {
+				return c.first == size;
+			});
+
+			if (image != now.checksums.end() && image->second != checksum) {
+				out << std::left << std::setw(28) << now.name << "OUTPUT CHANGED at " << size
+					<< " (the frames differ from the baseline)\n";
+				changed++;
+				passed = false;
+			}
+		}
+	}
+
+	out << std::defaultfloat << "[Gate] " << regressions << " regression(s), " << changed << " changed output(s), "
+		<< improvements << " improvement(s) (threshold " << opts.threshold * 100 << "%, alpha " << opts.alpha << ") : "
+		<< (passed ? "passed" : "FAILED") << std::endl;
+
+	return passed;
+}
@@ -0,0 +1,61 @@
+/**
+ * @author NoxFly
+ *
+ * Performance gate : the raw samples of a benchmark run, saved as a baseline,
+ * and compared against a later run with a rank test, so noise alone does not fail it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// a metric regresses when it is slower with p < alpha AND its median grew by more than this
+#define GATE_DEFAULT_THRESHOLD 0.10
+#define GATE_DEFAULT_ALPHA 0.01
+
+// shifts below this are timer noise, whatever their relative size (e.g. a 0.02 ms preprocessing)
+#define GATE_MIN_DELTA_MS 0.05
+
+// above n1 * n2 pairs, the U distribution is approximated by a normal one
+#define GATE_EXACT_LIMIT 400
+
+struct gateShader {
+	std::string name;
+	bool ok = false;
+	std::vector<std::pair<std::string, std::vector<double>>> metrics;	// e.g. "compile", "frame_gpu@640x360" : ms
+	std::vector<std::pair<std::string, uint64_t>> checksums;			// hash of the last frame, by resolution
+};
+
+struct gateRun {
+	std::string renderer;
+	std::string config;		// warmup, frames, repetitions, resolutions : runs only compare with the same
+	std::vector<gateShader> shaders;
+};
+
+struct gateOptions {
+	double threshold = GATE_DEFAULT_THRESHOLD;
+	double alpha = GATE_DEFAULT_ALPHA;
+};
+
+/**
+ * Text file, one line per metric with all its samples, meant to be checked in.
+ */
+bool writeBaseline(const std::string& path, const gateRun& run);
+bool readBaseline(const std::string& path, gateRun& run);
+
+/**
+ * One-sided Mann-Whitney U test : probability of a U at least this large
+ * if both samples came from the same distribution. Small when current is slower than baseline.
+ * Exact for small samples, normal approximation with tie correction above GATE_EXACT_LIMIT.
+ */
+double mannWhitneyGreater(const std::vector<double>& current, const std::vector<double>& baseline);
+
+/**
+ * Prints every metric against the baseline.
+ * Returns false if one regressed, if a frame checksum changed, or if a shader of the baseline fails now.
+ */
+bool checkBaseline(const gateRun& baseline, const gateRun& current, const gateOptions& opts, std::ostream& out);
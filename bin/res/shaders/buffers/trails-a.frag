@@ -0,0 +1,17 @@
+/**
+ * Buffer A of trails.frag : a dot following a Lissajous curve,
+ * drawn over its own previous frame, faded out.
+ */
+#version 460 core
+
+void mainImage() {
+    vec2 uv = fragCoord / uvResolution;
+    vec3 previous = iFrame == 0 ? vec3(0.0) : texture(sBufferA, uv).rgb;
+
+    vec2 p = (fragCoord * 2.0 - uvResolution) / uvResolution.y;
+    vec2 head = vec2(sin(fTime * 1.3), sin(fTime * 1.7)) * 0.7;
+
+    float intensity = smoothstep(0.06, 0.0, length(p - head));
+
+    fragColor = vec4(max(previous * 0.97, intensity * vec3(0.4, 0.8, 1.0)), 1.0);
+}
@@ -4,7 +4,7 @@ void mainImage() {
     vec2 center = uvResolution * 0.5;
     vec2 toCenter = uv - center;
     float dist = length(toCenter);
-    float distortion = sin(dist * 0.1 - fTime * 10) * 20.0 / (dist * 0.01 + 1.0);
+    float distortion = sin(dist * 0.1 - fTimeWrapped * 10) * 20.0 / (dist * 0.01 + 1.0);
     vec2 distortedUV = uv + normalize(toCenter) * distortion;
     uv = distortedUV;
 
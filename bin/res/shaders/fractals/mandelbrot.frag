@@ -8,6 +8,10 @@
 
 #include <helpers/common>
 #include <helpers/colorUtils>
+#include <helpers/perturbation>
+
+// compiled once per mode and iteration count : maxIt and the color branches become constants
+#specialize iMode iIncrement iDeepZoom
 
 
 const uint maxIt = uint(max(0, 128 + 20 * iIncrement));
@@ -60,9 +64,15 @@ vec3 hash13(float m) {
 void mainImage() {
     vec2 mdbt = (fragCoord / uvResolution * (mandelbrotRes.zw + abs(mandelbrotRes.xy)) + mandelbrotRes.xy) / fZoom;
 
-    mdbt += fvCenter;
+    float v;
 
-    const float v = mandelbrot(mdbt);
+    // deep zoom : fvCenter cannot hold the position anymore, iterate around the reference orbit
+    if(iDeepZoom != 0) {
+        v = 1.0 - float(perturbedIterations(mdbt + fvDeepOffset, maxIt)) / maxIt;
+    }
+    else {
+        v = mandelbrot(mdbt + fvCenter);
+    }
 
     vec3 color = vec3(0.0);
 
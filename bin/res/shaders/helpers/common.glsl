@@ -77,3 +77,67 @@ float noise(vec2 p) {
     
     return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
 }
+
+
+/**
+ * Arithmétique df64 : un nombre est la somme non évaluée de deux floats (hi, lo), environ 48 bits de mantisse.
+ * C'est ainsi que l'application envoie le centre, le zoom et le temps : vec2(fvCenter.x, fvCenterLo.x), vec2(fZoom, fZoomLo), vec2(fTime, fTimeLo).
+ * "precise" empêche le compilateur de simplifier les termes d'erreur.
+ */
+vec2 df64(float a) {
+    return vec2(a, 0.0);
+}
+
+vec2 df64TwoSum(float a, float b) {
+    precise float s = a + b;
+    precise float v = s - a;
+    precise float e = (a - (s - v)) + (b - v);
+    return vec2(s, e);
+}
+
+vec2 df64QuickTwoSum(float a, float b) {
+    precise float s = a + b;
+    precise float e = b - (s - a);
+    return vec2(s, e);
+}
+
+/**
+ * Somme de deux df64.
+ */
+vec2 df64Add(vec2 a, vec2 b) {
+    vec2 s = df64TwoSum(a.x, b.x);
+    const vec2 t = df64TwoSum(a.y, b.y);
+    precise float lo = s.y + t.x;
+    s = df64QuickTwoSum(s.x, lo);
+    lo = s.y + t.y;
+    return df64QuickTwoSum(s.x, lo);
+}
+
+vec2 df64Sub(vec2 a, vec2 b) {
+    return df64Add(a, -b);
+}
+
+/**
+ * Produit de deux df64.
+ */
+vec2 df64Mul(vec2 a, vec2 b) {
+    precise float p = a.x * b.x;
+    precise float e = fma(a.x, b.x, -p);
+    e += a.x * b.y + a.y * b.x;
+    return df64QuickTwoSum(p, e);
+}
+
+/**
+ * Arrondi d'un df64 au float le plus proche.
+ */
+float df64ToFloat(vec2 a) {
+    return a.x + a.y;
+}
+
+/**
+ * Centre de la caméra en double précision native (fp64, cœur depuis GLSL 4.00).
+ * Souvent bien plus lent que df64 sur les GPU grand public.
+ */
+dvec2 preciseCenter() {
+    return dvec2(fvCenter) + dvec2(fvCenterLo);
+}
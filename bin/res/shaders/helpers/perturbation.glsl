@@ -0,0 +1,52 @@
+/**
+ * @author NoxFly
+ *
+ * Perturbation theory for deep zooms :
+ * https://en.wikipedia.org/wiki/Plotting_algorithms_for_the_Mandelbrot_set#Perturbation_theory_and_series_approximation
+ *
+ * The application computes the orbit Z of a reference point in high precision (vOrbit, iOrbitLength),
+ * the pixel only iterates its offset dz to it, which stays representable in float at any zoom :
+ *
+ *     z = Z + dz, with dz' = 2 Z dz + dz² + dc
+ *
+ * Only valid when iDeepZoom is set.
+ */
+
+
+/**
+ * Iterations before the point reference + dc escapes, up to maxIt.
+ * dc : offset of the point to the reference, i.e. its position / fZoom + fvDeepOffset.
+ */
+uint perturbedIterations(vec2 dc, uint maxIt) {
+    vec2 dz = vec2(0.0);
+    int m = 0;
+    uint i = 0;
+
+    while(i < maxIt) {
+        const vec2 Z = vOrbit[m];
+
+        dz = vec2(
+            2.0 * (Z.x * dz.x - Z.y * dz.y) + (dz.x * dz.x - dz.y * dz.y),
+            2.0 * (Z.x * dz.y + Z.y * dz.x) + 2.0 * dz.x * dz.y
+        ) + dc;
+
+        m++;
+        i++;
+
+        const vec2 z = vOrbit[m] + dz;
+        const float z2 = dot(z, z);
+
+        if(z2 > 4.0) {
+            break;
+        }
+
+        // rebasing : back to the start of the orbit (Z = 0) when the point gets closer to 0 than to
+        // the reference, or when the reference runs out. Avoids the glitches of a single reference.
+        if(z2 < dot(dz, dz) || m >= iOrbitLength - 1) {
+            dz = z;
+            m = 0;
+        }
+    }
+
+    return i;
+}
@@ -0,0 +1,12 @@
+/**
+ * Multi-pass example : buffer A accumulates the trail, the image only displays it.
+ */
+#version 460 core
+
+#buffer A <buffers/trails-a>
+
+void mainImage() {
+    vec3 color = texture(sBufferA, fragCoord / uvResolution).rgb;
+
+    fragColor = vec4(pow(color, vec3(1.0 / 2.2)), 1.0);
+}
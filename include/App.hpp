@@ -17,9 +17,29 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <future>
+#include <unordered_map>
 
 #include "shader.hpp"
 #include "modelLoader.hpp"
+#include "options.hpp"
+#include "headless.hpp"
+#include "renderTarget.hpp"
+#include "frameStats.hpp"
+#include "programCache.hpp"
+#include "shaderCompiler.hpp"
+#include "fileWatcher.hpp"
+#include "preprocessor.hpp"
+#include "uniformBuffer.hpp"
+#include "bufferPass.hpp"
+#include "textureChannel.hpp"
+#include "threadPool.hpp"
+#include "referenceOrbit.hpp"
+#include "frameCapture.hpp"
+#include "frameLimiter.hpp"
+#include "session.hpp"
+#include "shaderLibrary.hpp"
+#include "console.hpp"
 
 #define OPENGL_VERSION_MAJOR 4
 #define OPENGL_VERSION_MINOR 6
@@ -28,6 +48,38 @@
 #define KEY_SPECIAL_COUNT 4
 #define KEY_FLAGS_COUNT 10
 
+// dynamic resolution : lowest scale of the window size, and default GPU frame time target (ms)
+#define RENDER_SCALE_MIN 0.25f
+#define DEFAULT_TARGET_FRAME_TIME (1000.0 / 60.0)
+
+// progressive tiled rendering : size of a tile, in pixels
+#define TILE_SIZE 128
+
+// temporal accumulation : samples per pixel when enabled from the keyboard
+#define DEFAULT_ACCUMULATION_SAMPLES 256
+
+// deep zoom : the reference orbit is used past this zoom, and the double-double center is exhausted past the max
+#define DEEP_ZOOM_THRESHOLD 1e4
+#define DEEP_ZOOM_MAX 1e28
+
+// period of fTimeWrapped : 1024 turns, so sin(n * fTimeWrapped) loops seamlessly for any integer n
+#define TIME_WRAP_PERIOD (2048.0 * 3.14159265358979323846)
+
+// shaders listed by the library (PageUp / PageDown, --library)
+#define SHADER_FOLDER "res/shaders"
+
+// #specialize : variants kept per shader, least recently used first out
+#define SHADER_VARIANT_MAX 8
+
+// capture (F12) : output when --capture is not given
+#define DEFAULT_CAPTURE_DIR "captures"
+
+// trace (F10) : output when --trace is not given
+#define DEFAULT_TRACE_FILE "trace.json"
+
+// console "screenshot" without a path
+#define DEFAULT_SCREENSHOT_FILE "screenshot.png"
+
 
 struct frustrum {
 	float fov;
@@ -47,24 +99,16 @@ union uniformValue {
 	glm::mat4 m4;
 };
 
-struct uniform {
-	GLint id;
-	uniformValue value;
-};
-
 struct uniforms {
-	uniform
+	uniformValue
 		mvp,
 		m,
 		v,
 		p,
 		mouse,
-		center,
 		resolution,
-		time,
 		delta,
 		ratio,
-		zoom,
 		increment;
 };
 
@@ -76,12 +120,19 @@ struct MVP {
 };
 
 struct FPSCounter {
-	float currentTime = 0;
-	float lastTime = 0;
-	float lastFrame = 0;
+	double currentTime = 0;
+	double lastTime = 0;
+	double lastFrame = 0;
 	float nbFrames = 0;
 };
 
+struct shaderVariant {
+	shader program{};					// id 0 until compiled
+	unsigned long long request = 0;		// background compilation in flight
+	unsigned long long lastUse = 0;
+	bool failed = false;				// not requested again
+};
+
 enum windowMode {
 	WINDOWED,
 	FULLSCREEN
@@ -90,35 +141,262 @@ enum windowMode {
 class App {
 
 	public:
-		App();
+		App(const options& opts = options());
 		~App();
 
 		void close();
+
+		/**
+		 * Renders until the console says quit. Closing the window only hides it, the next load shows it again :
+		 * the context, the surface and the compiled programs stay alive for the whole process.
+		 */
 		void run();
+		void runHeadless();
 		bool loadFractal(const std::string& name);
 
+		/**
+		 * GPU (timer queries) and CPU frame times of the current/last run.
+		 * Use summarize() on its members for mean and percentiles.
+		 */
+		const frameStats& getFrameStats() const;
+		void clearFrameStats();
+
+		/**
+		 * Waits for the GPU and collects every pending GPU timing.
+		 */
+		void flushFrameStats();
+
+		/**
+		 * Headless only : resizes the offscreen framebuffer and the surface.
+		 */
+		bool setOffscreenSize(unsigned int width, unsigned int height);
+
+		/**
+		 * Headless only : renders one frame into the offscreen framebuffer at the given time.
+		 * Does not wait for the GPU.
+		 */
+		void renderOffscreenFrame(double time, double delta);
+
+		/**
+		 * Headless only : reads the offscreen framebuffer back (RGBA, bottom row first). Waits for the GPU.
+		 */
+		bool readOffscreenPixels(std::vector<unsigned char>& pixels);
+
+		/**
+		 * Back to the initial view : zoom 1, centered, clock at 0.
+		 */
+		void reset();
+
+		/**
+		 * Console "set" and batch jobs : iIncrement, iMode, iFlagsMask, fZoom or fvCenter, followed by its values.
+		 */
+		bool setUniform(const std::vector<std::string>& args, std::string& error);
+
 	private:
 		void init();
 		void initGLFW();
 		void initGLEW();
+		void initHeadless();
 		void initSurface();
 
 		bool initShader();
+		void initShaderCompiler();
+
+		/**
+		 * Library (see shaderLibrary.hpp) : the programs of the current shader and of its buffers
+		 * are given to the library before another shader is loaded, and taken back from it if still up to date.
+		 */
+		void shelveShaders();
+		bool loadLibraryShader(shader& program, const std::string& name);
+
+		/**
+		 * --library : compiles every shader of SHADER_FOLDER in the background, in parallel.
+		 */
+		void precompileLibrary();
+
+		/**
+		 * Loads the next (1) or previous (-1) shader of SHADER_FOLDER.
+		 */
+		void switchShader(int direction);
+
+		/**
+		 * Specialized variants (#specialize) : picks into m_program the variant compiled for the current values
+		 * of the specialized uniforms, and requests it in the background if needed.
+		 * The generic program renders until it is ready.
+		 */
+		void updateVariant();
+		void clearVariants();
+
+		/**
+		 * Swaps in the program of a finished background reload, if any.
+		 * Called at frame boundaries only.
+		 */
+		void pollShaderCompiler();
+
+		/**
+		 * Watches the current shader file and every file it includes.
+		 */
+		void watchShaderFiles();
+
+		/**
+		 * After a reload : loads the buffers again if their declarations changed.
+		 */
+		void reloadBufferLayout();
 
 		std::vector<GLfloat> getVerticesScreenSized() const;
+		void getSurfaceSize(int& width, int& height) const;
 
 		void refreshResolution();
 		void refreshSurface();
 		void refreshShader();
 
-		void reset();
+		void update();
+		void render(bool clear = true);
+
+		/**
+		 * Renders the #buffer passes of the shader, in the order A to D.
+		 */
+		void renderBufferPasses();
+
+		/**
+		 * (Re)loads the #buffer passes declared by the current shader.
+		 */
+		bool loadBufferPasses();
+
+		/**
+		 * Requests the images of the #channel declarations of the current shader.
+		 * Cached ones are bound right away, the others sample black until they are loaded.
+		 */
+		void loadTextureChannels();
 
+		/**
+		 * Finishes the texture loads in flight that can be, at a frame boundary.
+		 * Headless and replays wait for all of them.
+		 */
+		void pollTextures();
+		void bindTextureChannels();
+
+		/**
+		 * Renders at the internal resolution into m_scaledTarget,
+		 * then upscales it to the window (dynamic resolution).
+		 */
+		void renderScaled();
+
+		/**
+		 * Moves the render scale toward the frame time target, from the latest GPU timing.
+		 */
+		void updateRenderScale();
+		void toggleDynamicResolution();
+
+		/**
+		 * Progressive mode : renders as many tiles of m_tiledTarget as fit the time budget,
+		 * then presents it. The tiles start over when the state of the shader changes.
+		 */
+		void renderTiled();
+		void restartTiles(int width, int height);
+		bool isTiling() const;
+		void toggleTiled();
+
+		/**
+		 * Temporal accumulation : blends a jittered frame into m_accumulationTarget,
+		 * until enough samples are averaged, then presents it.
+		 * Starts over when anything the shader sees changes.
+		 */
+		void renderAccumulated();
+		bool canAccumulate() const;
+
+		/**
+		 * The shader changed (program, buffer, texture) : the accumulated image and the tiles start over.
+		 */
+		void restartStillImage();
+		bool isAccumulating() const;
+		void toggleAccumulation();
+
+		/**
+		 * Deep zoom : swaps in a finished chunk of the reference orbit, and starts the next one.
+		 * A new reference is only chosen when the view moved too far from the current one.
+		 */
+		void updateReferenceOrbit();
+		bool isDeepZoom() const;
+
+		/**
+		 * Records the presented frames (see frameCapture.hpp), to --capture or DEFAULT_CAPTURE_DIR.
+		 * Rendering is never idle while recording.
+		 */
+		void startCapture();
+		void captureFrame();
+		void toggleCapture();
+
+		/**
+		 * F10 : the first press starts tracing (see trace.hpp),
+		 * the next ones write the last --trace-seconds to --trace or DEFAULT_TRACE_FILE.
+		 */
+		void dumpTrace();
+
+		/**
+		 * A shown window is a run of the shader : the view is reset,
+		 * the capture, the recording or the replay start, and they stop when it is hidden.
+		 */
+		void showWindow();
+		void hideWindow();
+
+		/**
+		 * Console (see console.hpp) : runs the queued commands, at a frame boundary.
+		 */
+		void pollConsole();
+		void runCommand(const consoleCommand& command);
+
+		/**
+		 * Writes the back buffer to m_screenshotPath, before it is swapped.
+		 */
+		void saveScreenshot();
+
+		/**
+		 * Sessions (see session.hpp) : state of the view a recording starts from.
+		 */
+		sessionState getSessionState() const;
+		void applySessionState(const sessionState& state);
+
+		/**
+		 * Opens --replay, restores its state and its resolution.
+		 */
+		bool startReplay();
+
+		/**
+		 * Handles the events of the next recorded frame and sets its clock.
+		 * False when the session is over.
+		 */
+		bool replayFrame();
+		void finishReplay();
+
+		/**
+		 * Content of the Globals block for the current state.
+		 */
+		void fillGlobals(globalsBlock& block) const;
+
+		/**
+		 * Content of the Globals block, without what changes from a frame to the next
+		 * when the view is still (time, frame, jitter, and the mouse if the shader ignores it).
+		 */
+		void fillStillState(globalsBlock& state) const;
 		void sendUniforms();
 
 		void createWindow();
 
 		void updateFPS();
 
+		/**
+		 * Idle mode : true if the next frame would be identical to the last one.
+		 */
+		bool isIdle() const;
+
+		/**
+		 * Input of the window : recorded with --record, ignored during a replay (Esc aside).
+		 */
+		void receiveKey(int key, int scancode, int action, int mods);
+		void receiveMouseButton(int button, int action, int mods);
+		void receiveMouseMove(double xpos, double ypos);
+
 		void onKey(int key, int scancode, int action, int mods);
 		void onMouseButton(int button, int action, int mods);
 		void onMouseMove(double xpos, double ypos);
@@ -127,25 +405,67 @@ class App {
 		void toggleFullscreen();
 		void toggleVSync();
 
+		options m_options;
+
 		windowMode m_windowMode;
 		GLFWwindow* m_window;
+		headlessContext m_headlessContext;
+		renderTarget m_offscreen;
 		GLuint m_windowWidth, m_windowHeight, m_realWidth, m_realHeight;
 		frustrum m_frustrum;
 
 		shader m_shader;
 		model m_surface;
+
+		std::vector<bufferPass> m_buffers;
+		renderTargetPool m_targetPool;
+		int m_frame;		// frames rendered since the shader was loaded (iFrame)
+
+		ShaderCompiler m_compiler;
+		GLFWwindow* m_compilerWindow;		// hidden, shares its objects with m_window
+		unsigned long long m_reloadRequest;
+		double m_reloadStart;				// F5 press time, in seconds
+		double m_reloadCompileTime;			// ms spent by the worker
+		bool m_reloadSwapped;				// the next presented frame is the first one of the new program
+		FileWatcher m_watcher;
 		
 		std::string m_fractalName;
 		uniforms m_uniforms;
 		MVP m_mvp;
 		
 		FPSCounter m_fps;
+		frameStats m_stats;
 		
 		int m_zooming;
 		glm::vec2 m_displacement;
 
 		bool m_vsync;
 		bool m_needEscape;
+		bool m_redraw;		// something visible changed since the last frame (idle mode)
+
+		bool m_dynamicResolution;
+		double m_targetFrameTime;					// ms
+		float m_renderScale;
+		renderTarget m_scaledTarget;				// window-sized, only its bottom-left corner is used
+		unsigned long long m_lastScaledSample;		// last GPU sample the controller used
+
+		bool m_tiled;
+		renderTarget m_tiledTarget;					// persistent, presented every frame
+		std::vector<glm::ivec4> m_tiles;			// x, y, width, height ; from the center outward
+		size_t m_nextTile;
+		size_t m_tilesPerFrame;
+		double m_tiledTime;							// the time is frozen during a pass
+		globalsBlock m_tiledState;					// state the current pass renders
+		GLuint m_tiledQuery;						// GL_TIME_ELAPSED of the last batch of tiles
+		size_t m_tiledQueryTiles;
+		bool m_tiledQueryPending;
+		bool m_tiledDrawing;						// renderTiled() is drawing : sendUniforms() sends m_tiledTime
+
+		unsigned int m_accumulationSamples;			// target, 0 = disabled
+		unsigned int m_accumulated;					// samples averaged so far
+		renderTarget m_accumulationTarget;			// RGBA32F
+		globalsBlock m_accumulationState;
+		glm::vec2 m_jitter;
 		
 		GLint m_mouseFlagsUniforms[MOUSE_BTN_COUNT];
 		GLint m_boolFlagsUniforms[KEY_FLAGS_COUNT];
@@ -153,8 +473,45 @@ class App {
 		
 		int m_keyTabUniform;
 		
-		GLuint m_mouseFragLoc;
-		GLuint m_keysFragLoc;
-		GLuint m_flagsFragLoc;
-		GLuint m_keyTabFragLoc;
+		globalsBlock m_globals;		// last content sent to the Globals block
+		uniformRing m_globalsRing;
+
+		// camera and clock : sent as hi/lo float pairs, so they do not degrade with the zoom depth or the uptime
+		doubleDouble m_centerX, m_centerY;
+		double m_zoom;
+		double m_time;								// seconds since the last reset
+
+		ThreadPool m_threadPool;
+		referenceOrbit m_orbit;						// already uploaded, without its points
+		std::future<referenceOrbit> m_orbitTask;	// next chunk, or new reference
+		GLuint m_orbitBuffer;
+
+		FrameCapture m_capture;
+
+		TextureCache m_textures;					// decoded on m_threadPool
+		std::vector<textureChannel> m_channels;		// of the current shader
+
+		FrameLimiter m_limiter;						// --fps
+		unsigned long long m_clockFrame;			// frames since the last reset, for --fixed-step
+
+		SessionRecorder m_recorder;					// --record
+		SessionPlayer m_player;						// --replay
+		double m_replayStart;						// seconds
+
+		ShaderLibrary m_library;
+		std::vector<std::string> m_libraryNames;	// SHADER_FOLDER, listed on first use
+		unsigned long long m_libraryRequest;		// --library batch
+		size_t m_libraryPending;
+
+		std::vector<std::string> m_specialized;						// #specialize'd uniforms of the current shader
+		std::unordered_map<std::string, shaderVariant> m_variants;	// by specializationKey()
+		unsigned long long m_variantRequest;						// one variant is compiled at a time
+		unsigned long long m_variantClock;
+		GLuint m_program;											// m_shader.id, or its variant for the current values
+
+		Console m_console;
+		bool m_visible;
+		bool m_quit;
+		std::string m_screenshotPath;				// empty when none is pending
+		consoleCommand m_screenshotCommand;			// answered once written
 };
\ No newline at end of file
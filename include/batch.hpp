@@ -0,0 +1,43 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+
+// output of --batch when --output is not given
+#define DEFAULT_BATCH_DIR "batch"
+
+/**
+ * A still to render : one frame of a shader at a given time, resolution and view.
+ */
+struct batchJob {
+	std::string shader;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	double time = 0;
+	std::vector<std::vector<std::string>> uniforms;		// App::setUniform() arguments
+	std::string output;
+};
+
+/**
+ * Reads a job list, one job per line :
+ *
+ *     fractals/mandelbrot 1920x1080 fZoom=40 fvCenter=-0.745,0.186 iMode=1 out=poster.png
+ *     * 320x180 time=2
+ *
+ * The size defaults to --size, the time to 0, the output to <shader>_<w>x<h>.<ext> in the output folder.
+ * A "*" renders every shader of the library. Empty lines and # comments are skipped.
+ */
+bool parseBatchJobs(const std::string& path, const options& opts, std::vector<batchJob>& jobs);
+
+/**
+ * --batch : renders the jobs on a pool of workers, each with its own headless context,
+ * every image written to disk by the worker that rendered it. Prints each job and a summary.
+ * Returns false if a job failed.
+ */
+bool runBatch(const options& opts);
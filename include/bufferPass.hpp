@@ -0,0 +1,67 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+#include "renderTarget.hpp"
+
+// Buffer A to D
+#define MAX_BUFFER_PASSES 4
+
+// sBufferA..D are bound to the texture units BUFFER_TEXTURE_UNIT to BUFFER_TEXTURE_UNIT + 3
+#define BUFFER_TEXTURE_UNIT 0
+
+/**
+ * An offscreen pass declared by the image shader with
+ *
+ *     #buffer A <path/of/shader> [rgba8|rgba16f|rgba32f]
+ *
+ * Buffers are rendered in alphabetical order before the image, every frame.
+ * Every pass (the image included) reads the buffers through sBufferA..D : a buffer already
+ * rendered this frame gives its new content, the others, itself included, their previous frame.
+ * Each buffer ping-pongs between two targets for that.
+ */
+struct bufferPass {
+	unsigned int index = 0;			// 0 = A, ..., 3 = D
+	std::string shaderName;
+	GLenum format = GL_RGBA16F;
+	shader program{};
+	renderTarget targets[2];
+	unsigned int current = 0;		// target holding the latest frame
+	unsigned long long reloadRequest = 0;
+};
+
+/**
+ * Reads the #buffer directives of the last expansion of the given image shader.
+ * The programs are not loaded.
+ */
+bool parseBufferPasses(const std::string& shaderName, std::vector<bufferPass>& passes);
+
+/**
+ * Whether both lists declare the same buffers, shaders and formats.
+ */
+bool sameBufferPasses(const std::vector<bufferPass>& a, const std::vector<bufferPass>& b);
+
+/**
+ * (Re)allocates both targets of the pass at the given size, cleared.
+ * Does nothing if they already have this size.
+ */
+bool resizeBufferPass(bufferPass& pass, renderTargetPool& pool, GLuint width, GLuint height);
+
+/**
+ * Deletes the programs and hands the targets back to the pool.
+ */
+void deleteBufferPasses(std::vector<bufferPass>& passes, renderTargetPool& pool);
+
+/**
+ * Binds the latest content of every buffer to its sampler unit.
+ */
+void bindBufferTextures(const std::vector<bufferPass>& passes);
+void unbindBufferTextures();
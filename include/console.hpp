@@ -0,0 +1,69 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct consoleClient;
+struct consoleState;
+
+/**
+ * A line typed in the terminal or sent to the socket, split on whitespace.
+ */
+struct consoleCommand {
+	std::string name;
+	std::vector<std::string> args;
+	std::shared_ptr<consoleClient> client;	// where the reply goes, the terminal if null
+};
+
+/**
+ * Reads the commands on threads of its own, so the window keeps rendering while waiting for them :
+ * the terminal, and optionally a local Unix domain socket, one line per command, e.g.
+ *
+ *     echo "load fractals/mandelbrot" | nc -U /tmp/playground.sock
+ *
+ * The rendering thread polls them at frame boundaries and answers each one with reply().
+ */
+class Console {
+
+	public:
+		Console();
+		~Console();
+
+		/**
+		 * Starts reading the terminal, and listening on socketPath if not empty (not on Windows).
+		 */
+		bool start(const std::string& socketPath);
+		void stop();
+
+		/**
+		 * Called from the reading threads every time a command is queued, e.g. to wake up an event loop.
+		 */
+		void setNotifier(const std::function<void()>& notifier);
+
+		/**
+		 * Returns the oldest queued command, without waiting.
+		 */
+		bool poll(consoleCommand& command);
+
+		/**
+		 * Answers a command : printed in the terminal, or sent back to the socket client as one line.
+		 */
+		void reply(const consoleCommand& command, const std::string& text, bool error = false);
+
+	private:
+		void listen();
+		void closeSocket();
+
+		// shared with the terminal thread, which cannot be interrupted and outlives the console
+		std::shared_ptr<consoleState> m_state;
+		std::thread m_socketThread;
+		int m_socketFd;
+		std::string m_socketPath;
+};
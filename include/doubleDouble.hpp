@@ -0,0 +1,64 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <cmath>
+
+/**
+ * Unevaluated sum of two doubles, about 32 significant digits.
+ * Relies on strict IEEE rounding : do not build with -ffast-math.
+ */
+struct doubleDouble {
+	double hi = 0;
+	double lo = 0;
+};
+
+// error-free transformations
+inline doubleDouble twoSum(double a, double b) {
+	const double s = a + b;
+	const double v = s - a;
+	return { s, (a - (s - v)) + (b - v) };
+}
+
+inline doubleDouble quickTwoSum(double a, double b) {
+	const double s = a + b;
+	return { s, b - (s - a) };
+}
+
+inline doubleDouble twoProd(double a, double b) {
+	const double p = a * b;
+	return { p, std::fma(a, b, -p) };
+}
+
+inline doubleDouble ddAdd(doubleDouble a, doubleDouble b) {
+	doubleDouble s = twoSum(a.hi, b.hi);
+	const doubleDouble t = twoSum(a.lo, b.lo);
+
+	s.lo += t.hi;
+	s = quickTwoSum(s.hi, s.lo);
+	s.lo += t.lo;
+
+	return quickTwoSum(s.hi, s.lo);
+}
+
+inline doubleDouble ddAdd(doubleDouble a, double b) {
+	doubleDouble s = twoSum(a.hi, b);
+	s.lo += a.lo;
+	return quickTwoSum(s.hi, s.lo);
+}
+
+inline doubleDouble ddSub(doubleDouble a, doubleDouble b) {
+	return ddAdd(a, doubleDouble{ -b.hi, -b.lo });
+}
+
+inline doubleDouble ddMul(doubleDouble a, doubleDouble b) {
+	doubleDouble p = twoProd(a.hi, b.hi);
+	p.lo += a.hi * b.lo + a.lo * b.hi;
+	return quickTwoSum(p.hi, p.lo);
+}
+
+inline double ddToDouble(doubleDouble a) {
+	return a.hi + a.lo;
+}
@@ -0,0 +1,58 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Watches a set of files for modifications, without blocking.
+ *
+ * On Linux, the folders of the files are watched with inotify, so editors saving
+ * through a temporary file and a rename are seen as well. Elsewhere, the modification
+ * times are polled a few times per second.
+ *
+ * Bursts of events are coalesced : poll() only reports a change once no event came
+ * for the debounce delay, and only if the content of a watched file really changed.
+ */
+class FileWatcher {
+
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		/**
+		 * Replaces the set of watched files.
+		 * The known content of the files already watched is kept.
+		 */
+		bool watch(const std::vector<std::string>& files);
+		void clear();
+
+		void setDebounce(unsigned int milliseconds);
+
+		/**
+		 * Returns true once per settled burst of modifications that changed
+		 * the content of at least one watched file. Never blocks.
+		 */
+		bool poll();
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		bool readEvents();
+		bool contentChanged();
+
+		int m_fd;
+		std::unordered_map<int, std::string> m_directories;		// watch descriptor -> folder
+		std::unordered_map<std::string, uint64_t> m_files;		// path -> content hash
+		std::unordered_map<std::string, int64_t> m_mtimes;		// path -> mtime, polling fallback
+		clock::duration m_debounce;
+		clock::time_point m_lastEvent;
+		clock::time_point m_lastScan;
+		bool m_pending;
+};
@@ -0,0 +1,96 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+
+#include "image.hpp"
+#include "threadPool.hpp"
+
+// pixel pack buffers in flight : a frame is mapped up to CAPTURE_RING_SIZE - 1 frames after its readback
+#define CAPTURE_RING_SIZE 3
+
+// frames read back but not written yet. Past it, new frames are dropped (real-time) or waited for.
+#define CAPTURE_MAX_PENDING 8
+
+struct captureStats {
+	unsigned long long written = 0;
+	unsigned long long dropped = 0;		// not captured : the encoders were too far behind
+	unsigned long long late = 0;		// readbacks still running when their buffer was needed again (GPU stall)
+	unsigned long long failed = 0;		// could not be written
+};
+
+/**
+ * Records the rendered frames without stalling the pipeline : each frame is read into a ring of
+ * pixel pack buffers, mapped a few frames later when the copy is done, and encoded on the thread pool.
+ *
+ * PNG and raw frames are written as a sequence of files in a folder.
+ * Y4M frames are converted in parallel but written in order to a single file or to stdout ("-"),
+ * e.g. to pipe them into ffmpeg.
+ */
+class FrameCapture {
+
+	public:
+		explicit FrameCapture(ThreadPool& pool);
+		~FrameCapture();
+
+		/**
+		 * fps only goes into the Y4M header.
+		 * dropWhenBusy : drop frames rather than wait when the encoders fall behind (real-time capture).
+		 */
+		bool start(const std::string& output, imageFormat format, unsigned int width, unsigned int height, double fps, bool dropWhenBusy);
+
+		/**
+		 * Queues the readback of the framebuffer, which must have the size given to start(),
+		 * and hands the readbacks finished since the last call to the encoders.
+		 * Only waits for the GPU when the whole ring is still in flight.
+		 */
+		void capture(GLuint framebuffer);
+
+		/**
+		 * Finishes the readbacks and the encoding, closes the output and prints the statistics.
+		 */
+		void stop();
+
+		bool isCapturing() const;
+		unsigned int getWidth() const;
+		unsigned int getHeight() const;
+		captureStats getStats() const;
+
+	private:
+		struct slot {
+			GLuint pbo = 0;
+			GLsync fence = nullptr;
+			unsigned long long frame = 0;
+		};
+
+		// shared with the encoding jobs, which may outlive a capture
+		struct encoder;
+
+		/**
+		 * Hands the finished readbacks to the encoders, oldest first.
+		 * With waitOldest, the oldest one is waited for if needed (late frame).
+		 */
+		void collect(bool waitOldest);
+
+		/**
+		 * Whether there is room for one more frame. May drop it or wait, depending on the mode.
+		 */
+		bool reserve();
+
+		void encode(slot& slot);
+
+		ThreadPool& m_pool;
+		std::shared_ptr<encoder> m_encoder;
+		slot m_slots[CAPTURE_RING_SIZE];
+		unsigned int m_oldest;
+		unsigned int m_inFlight;
+		unsigned long long m_frame;		// frames read back since start()
+		unsigned int m_width, m_height;
+		bool m_dropWhenBusy;
+};
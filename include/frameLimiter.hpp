@@ -0,0 +1,47 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <chrono>
+
+// bounds of the time spun before a deadline, adapted to how late the OS wakes up a sleeping thread (seconds)
+#define FRAME_LIMITER_MIN_SPIN 0.0002
+#define FRAME_LIMITER_MAX_SPIN 0.004
+
+/**
+ * Paces a loop to a target frame rate : sleeps for most of the remaining frame time,
+ * then spins (yielding) for the last fraction of a millisecond, where sleeping is too imprecise.
+ * Deadlines follow a fixed grid, so the pace does not drift with the frame times.
+ */
+class FrameLimiter {
+
+	public:
+		FrameLimiter();
+
+		/**
+		 * 0 disables the limiter.
+		 */
+		void setTargetFps(double fps);
+		double getTargetFps() const;
+		bool isEnabled() const;
+
+		/**
+		 * Starts a new grid from now, e.g. after the loop slept for an unknown time.
+		 */
+		void reset();
+
+		/**
+		 * Returns at the next deadline. Does nothing if it is already passed.
+		 */
+		void wait();
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		double m_period;			// seconds, 0 = disabled
+		clock::time_point m_deadline;
+		double m_spin;				// seconds before the deadline spent spinning
+		bool m_started;
+};
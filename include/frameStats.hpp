@@ -0,0 +1,99 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+// Number of frames a GPU timing can stay in flight before being read back.
+// Reading them this late means the results are always ready, so it never stalls.
+#define GPU_TIMER_LATENCY 4
+
+// Number of frames kept for the rolling statistics.
+#define FRAME_STATS_WINDOW 600
+
+/**
+ * Ring of GL_TIMESTAMP query pairs, one pair per frame in flight.
+ */
+struct gpuTimer {
+	GLuint queries[GPU_TIMER_LATENCY][2] = {};
+	unsigned long long issued = 0;
+	unsigned long long resolved = 0;
+	bool recording = false;
+};
+
+bool createGpuTimer(gpuTimer& timer);
+void deleteGpuTimer(gpuTimer& timer);
+
+/**
+ * Records the start/end timestamps of the current frame.
+ * If every slot of the ring is still pending, the frame is not timed.
+ */
+void beginGpuTimer(gpuTimer& timer);
+void endGpuTimer(gpuTimer& timer);
+
+/**
+ * Reads back the oldest timed frame if its result is available, without waiting.
+ * Returns false if there is nothing to read yet.
+ */
+bool readGpuTimer(gpuTimer& timer, double& milliseconds);
+
+
+/**
+ * Fixed-size window of the last samples.
+ */
+struct rollingStats {
+	std::vector<double> samples;
+	size_t next = 0;
+	unsigned long long total = 0;
+};
+
+struct statsSummary {
+	size_t count = 0;
+	double mean = 0;
+	double stddev = 0;
+	double min = 0;
+	double p50 = 0;
+	double p95 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+void pushSample(rollingStats& stats, double value, size_t window = FRAME_STATS_WINDOW);
+void clearSamples(rollingStats& stats);
+
+/**
+ * The most recent sample, 0 if there is none.
+ */
+double lastSample(const rollingStats& stats);
+statsSummary summarize(const rollingStats& stats);
+
+
+/**
+ * Per-frame GPU and CPU times, in milliseconds.
+ */
+struct frameStats {
+	gpuTimer timer;
+	rollingStats gpu;
+	rollingStats cpu;
+};
+
+/**
+ * Reads every GPU timing that became available and feeds the rolling stats.
+ */
+void collectFrameStats(frameStats& stats);
+
+/**
+ * Prints the GPU and CPU summaries as a small table.
+ */
+void writeFrameStats(std::ostream& out, const frameStats& stats);
+
+/**
+ * Writes the summaries to the given file, or to stdout if path is "-".
+ */
+bool dumpFrameStats(const std::string& path, const frameStats& stats);
@@ -0,0 +1,34 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+/**
+ * OpenGL context without any window nor display server.
+ *
+ * On Linux, it is an EGL context on Mesa's surfaceless platform, which
+ * works on GPU-less machines through the llvmpipe software rasterizer.
+ * Elsewhere, it falls back to a hidden GLFW window.
+ *
+ * The handles are opaque so this header does not drag EGL/GLFW in.
+ */
+struct headlessContext {
+	void* display = nullptr; // EGLDisplay
+	void* context = nullptr; // EGLContext, or GLFWwindow* for the fallback
+};
+
+/**
+ * Creates an OpenGL 4.6 core context (4.5 if 4.6 is not available),
+ * sharing its objects with the given context if not null.
+ * Does not make it current.
+ */
+bool createHeadlessContext(headlessContext& ctx, const headlessContext* shared = nullptr);
+
+/**
+ * Makes the context current on the calling thread.
+ * A null context releases the current one.
+ */
+bool makeHeadlessContextCurrent(const headlessContext* ctx);
+
+void destroyHeadlessContext(headlessContext& ctx);
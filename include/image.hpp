@@ -0,0 +1,57 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum imageFormat {
+	IMAGE_PNG,
+	IMAGE_RAW,
+	IMAGE_Y4M		// video : every frame in a single YUV4MPEG2 stream (see frameCapture.hpp)
+};
+
+/**
+ * Writes a 8-bit RGBA image as an uncompressed PNG file.
+ * When flipY is true, rows are written bottom to top,
+ * which is what glReadPixels returns.
+ * Returns false if the file could not be written.
+ */
+bool writePNG(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height, bool flipY = true);
+
+/**
+ * Reads a PNG file as 8-bit RGBA, top row first.
+ * Every color type and bit depth is accepted (16-bit channels keep their high byte), interlaced files are not.
+ * Returns false if the file could not be read or decoded.
+ */
+bool readPNG(const std::string& path, std::vector<unsigned char>& pixels, unsigned int& width, unsigned int& height);
+
+/**
+ * Writes a 8-bit RGBA image as raw bytes (width * height * 4, top to bottom, no header).
+ * Returns false if the file could not be written.
+ */
+bool writeRaw(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height, bool flipY = true);
+
+/**
+ * Converts a 8-bit RGBA image to the planar YUV 4:2:0 of a Y4M frame (BT.601 full range, C420jpeg).
+ * Odd sizes round the chroma planes up.
+ */
+void rgbaToYUV420(const unsigned char* pixels, unsigned int width, unsigned int height, std::vector<unsigned char>& yuv, bool flipY = true);
+
+/**
+ * Header of a Y4M stream, the fps as a fraction of 1000.
+ */
+std::string y4mHeader(unsigned int width, unsigned int height, double fps);
+
+/**
+ * Writes the image in the given format. IMAGE_Y4M is not an image format and fails.
+ * The extension is not appended to the path.
+ */
+bool writeImage(const std::string& path, imageFormat format, const unsigned char* pixels, unsigned int width, unsigned int height, bool flipY = true);
+
+/**
+ * Returns the file extension used for the given format, without the dot.
+ */
+const char* imageExtension(imageFormat format);
@@ -0,0 +1,56 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "image.hpp"
+#include "trace.hpp"
+
+/**
+ * Command line options.
+ * Without any option, the application starts in interactive mode (prompt + window).
+ */
+struct options {
+	bool headless = false;
+	std::string shaderName;
+	unsigned int width = 1280;
+	unsigned int height = 720;
+	unsigned int frameCount = 60;
+	double fixedDelta = 1.0 / 60.0;
+	std::string outputDir;
+	imageFormat outputFormat = IMAGE_PNG;
+	std::string statsPath;
+	std::string programCacheDir = "cache/programs";
+	uint64_t programCacheSize = 64ull * 1024 * 1024;
+	bool watch = true;				// reload the shader when one of its files changes
+	bool idle = true;				// only redraw on changes when the shader does not read the time
+	double targetFrameTime = 0;		// ms, dynamic resolution enabled if > 0
+	bool tiled = false;				// progressive tiled rendering
+	double tileBudget = 8.0;		// ms of GPU time spent on tiles per frame
+	unsigned int accumulate = 0;	// samples per pixel of the temporal accumulation, disabled if 0
+	std::string captureOutput;		// records from the start when set : folder, .y4m file or "-"
+	double captureFps = 60.0;		// frame rate written in the Y4M header
+	double targetFps = 0;			// frame rate limit, disabled if 0
+	double fixedStep = 0;			// fTime advances by exactly 1 / fixedStep per frame if > 0
+	std::string recordPath;			// session file the input is recorded to
+	std::string replayPath;			// session file to replay instead of the live input
+	bool library = false;			// compile every shader in the background at startup
+	std::string tracePath;			// trace from the start, written when leaving
+	double traceSeconds = TRACE_DEFAULT_SECONDS;	// window written to the trace
+	std::string socketPath;			// Unix domain socket the console also reads commands from
+	std::string batchPath;			// job list of the batch renderer (headless)
+	unsigned int threads = 0;		// batch workers, 0 = one per core
+	bool help = false;
+};
+
+/**
+ * Parses the command line into the options.
+ * Prints the error and returns false on unknown or malformed arguments.
+ */
+bool parseOptions(int argc, char** argv, options& opts);
+
+void printUsage(const char* program);
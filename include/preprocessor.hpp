@@ -0,0 +1,60 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Shader preprocessor : expands the #include <path> directives.
+ *
+ * - Includes can be nested, and every file is included at most once per shader (include-once),
+ *   so including helpers/common twice, or circular includes, are harmless.
+ * - Every file is cached by path, modification time and size. Expanding a shader again
+ *   only re-reads the files that changed on disk, and reuses the whole expansion if none did.
+ * - #line directives are emitted around every included chunk, each file having its own
+ *   source string number, so mapShaderLog() can point driver errors back to the original file.
+ * - Playground directives (#buffer, #channel, #specialize) are not GLSL : they are removed from the code
+ *   and collected, see getShaderDirectives().
+ */
+
+struct shaderDirective {
+	std::string name;					// without '#', e.g. "buffer"
+	std::vector<std::string> arguments;	// whitespace separated, "<path>" given without the brackets
+	std::string file;
+	unsigned int line = 0;
+};
+
+struct preprocessorStats {
+	unsigned long long filesRead = 0;
+	unsigned long long filesReused = 0;
+	unsigned long long expansionsReused = 0;
+};
+
+/**
+ * Expands the given shader file (path relative to the binary's folder).
+ * Returns false if the file or one of its dependencies cannot be read.
+ */
+bool preprocessShader(const std::string& filepath, std::string& shaderContent);
+
+/**
+ * Every file the last expansion of the given shader depended on, itself included.
+ */
+std::vector<std::string> getShaderDependencies(const std::string& filepath);
+
+/**
+ * Playground directives found by the last expansion of the given shader, in source order.
+ */
+std::vector<shaderDirective> getShaderDirectives(const std::string& filepath);
+
+/**
+ * Rewrites the "<source string>:<line>" prefixes of a driver info log
+ * (Mesa, NVIDIA and AMD formats) as "<file>:<line>".
+ */
+std::string mapShaderLog(const std::string& log);
+
+void clearPreprocessorCache();
+
+preprocessorStats getPreprocessorStats();
@@ -0,0 +1,50 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Persistent cache of linked programs (glGetProgramBinary / glProgramBinary).
+ *
+ * Entries are keyed by a hash of the full sources and of the GL_RENDERER/GL_VERSION strings,
+ * so a driver update or another GPU never loads a stale binary.
+ * The cache is size-capped : the least recently used entries are evicted first.
+ */
+
+struct programCacheStats {
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	unsigned long long stores = 0;
+	unsigned long long evictions = 0;
+	unsigned long long rejected = 0;	// binaries refused by the driver
+};
+
+/**
+ * Must be called with a current context.
+ * The cache stays disabled if the driver exposes no binary format.
+ */
+bool initProgramCache(const std::string& directory, uint64_t maxBytes);
+
+bool isProgramCacheEnabled();
+
+uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+/**
+ * Creates a program from the cached binary of the given key.
+ * Returns false on miss, or if the driver refused the binary (the entry is then removed).
+ */
+bool loadCachedProgram(GLuint& program, uint64_t key);
+
+/**
+ * Stores the binary of a linked program, which must have been linked
+ * with GL_PROGRAM_BINARY_RETRIEVABLE_HINT. Evicts old entries if needed.
+ */
+void storeCachedProgram(GLuint program, uint64_t key);
+
+programCacheStats getProgramCacheStats();
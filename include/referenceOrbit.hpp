@@ -0,0 +1,71 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "doubleDouble.hpp"
+#include "threadPool.hpp"
+
+// shader storage binding of the ReferenceOrbit block declared by the prelude
+#define REFERENCE_ORBIT_BINDING 0
+
+// longest orbit kept, and how many iterations are computed at once
+#define REFERENCE_ORBIT_MAX_LENGTH 65536
+#define REFERENCE_ORBIT_CHUNK 4096
+
+// candidates tried around the center when choosing a reference
+#define REFERENCE_ORBIT_PROBES 17
+
+// farthest the view center can be from the reference, in units of 1/zoom, before a new one is chosen
+#define REFERENCE_ORBIT_MAX_OFFSET 16.0
+
+/**
+ * Mandelbrot orbit Z(n+1) = Z(n)² + c of a reference point c, computed in double-double
+ * and rounded to floats for the GPU. The shaders only iterate the small offset of
+ * their pixel to it (perturbation), which single precision handles at any zoom.
+ *
+ * Computed by chunks : points only holds the latest one, starting at index first.
+ */
+struct referenceOrbit {
+	doubleDouble cx, cy;			// the reference
+	doubleDouble zx, zy;			// last point, to extend the orbit
+	std::vector<glm::vec2> points;
+	size_t first = 0;
+	bool escaped = false;
+	double milliseconds = 0;		// spent computing this chunk
+
+	size_t length() const {
+		return first + points.size();
+	}
+};
+
+/**
+ * Chooses a reference in the view around (x, y) and computes its first chunk.
+ * Candidates spread within 1/zoom of the center are iterated in parallel on the pool,
+ * and the one staying bounded the longest (the closest on a tie) is kept.
+ */
+referenceOrbit computeReferenceOrbit(doubleDouble x, doubleDouble y, double zoom, ThreadPool& pool);
+
+/**
+ * Continues the orbit by up to count iterations, replacing points by the new chunk.
+ */
+void extendReferenceOrbit(referenceOrbit& orbit, size_t count);
+
+/**
+ * Whether the view centered on (x, y) can still use this reference :
+ * the float offset to it must keep a sub-pixel precision.
+ */
+bool isReferenceOrbitValid(const referenceOrbit& orbit, doubleDouble x, doubleDouble y, double zoom);
+
+/**
+ * Writes the chunk into the storage buffer (created on first use) and binds it.
+ * The first chunk of an orbit replaces the previous orbit.
+ */
+bool uploadReferenceOrbit(GLuint& buffer, const referenceOrbit& orbit);
+void deleteReferenceOrbitBuffer(GLuint& buffer);
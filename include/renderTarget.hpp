@@ -0,0 +1,58 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+struct renderTarget {
+	GLuint fbo = 0;
+	GLuint texture = 0;
+	GLuint width = 0;
+	GLuint height = 0;
+	GLenum format = GL_RGBA8;
+};
+
+/**
+ * Creates a framebuffer with a single color texture attachment.
+ * Returns false and leaves the target empty if the framebuffer is incomplete.
+ */
+bool createRenderTarget(renderTarget& target, GLuint width, GLuint height, GLenum format = GL_RGBA8);
+
+/**
+ * Destroys the framebuffer and its texture, if any.
+ */
+void deleteRenderTarget(renderTarget& target);
+
+
+// Number of unused targets a pool keeps around before deleting the oldest ones.
+#define RENDER_TARGET_POOL_SIZE 8
+
+/**
+ * Recycles render targets : released targets are handed back by the next acquire
+ * of the same size and format, e.g. when resizing back and forth or reloading a shader.
+ */
+struct renderTargetPool {
+	std::vector<renderTarget> available;	// oldest first
+	unsigned long long created = 0;
+	unsigned long long reused = 0;
+};
+
+/**
+ * Returns a target of the given size and format, recycled if possible.
+ * Its content is undefined.
+ */
+bool acquireRenderTarget(renderTargetPool& pool, renderTarget& target, GLuint width, GLuint height, GLenum format);
+
+/**
+ * Hands the target back to the pool, and empties it.
+ */
+void releaseRenderTarget(renderTargetPool& pool, renderTarget& target);
+
+/**
+ * Deletes every target kept by the pool.
+ */
+void clearRenderTargetPool(renderTargetPool& pool);
@@ -0,0 +1,123 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "doubleDouble.hpp"
+
+// first bytes of a session file, followed by its version
+#define SESSION_MAGIC "SPSESS"
+#define SESSION_VERSION 1
+
+/**
+ * State of the view when the recording started.
+ * Everything else the shader sees is driven by the recorded events.
+ */
+struct sessionState {
+	std::string shaderName;
+	uint32_t width = 0;			// framebuffer size, in pixels
+	uint32_t height = 0;
+	doubleDouble centerX, centerY;
+	double zoom = 1.0;
+	int32_t increment = 0;
+	int32_t mode = 0;			// iMode (Tab)
+	int32_t flagsMask = 0;		// keys 0-9
+	int32_t keyMask = 0;		// right shift, right ctrl, left alt, space
+	int32_t mouseMask = 0;		// left, middle, right
+	int32_t zooming = 0;		// left shift / ctrl held
+	int32_t panX = 0;			// arrows held
+	int32_t panY = 0;
+	double mouseX = 0;
+	double mouseY = 0;
+};
+
+enum sessionEventType : uint8_t {
+	SESSION_KEY = 1,
+	SESSION_MOUSE_BUTTON = 2,
+	SESSION_MOUSE_MOVE = 3
+};
+
+struct sessionEvent {
+	sessionEventType type = SESSION_KEY;
+	int32_t key = 0;			// or mouse button
+	int32_t scancode = 0;
+	int32_t action = 0;
+	int32_t mods = 0;
+	double x = 0, y = 0;		// mouse move
+};
+
+/**
+ * A rendered frame : the events handled since the previous one, and its clock.
+ */
+struct sessionFrame {
+	double time = 0;
+	float delta = 0;
+	std::vector<sessionEvent> events;
+};
+
+/**
+ * Writes the input stream of an interactive run, frame by frame, to a compact binary file :
+ * the header (magic, version, sessionState), then a record per event and per frame, in order.
+ * Events are written as they come and belong to the next frame record.
+ */
+class SessionRecorder {
+
+	public:
+		SessionRecorder();
+		~SessionRecorder();
+
+		bool start(const std::string& path, const sessionState& state);
+		void stop();
+		bool isRecording() const;
+
+		void key(int key, int scancode, int action, int mods);
+		void mouseButton(int button, int action, int mods);
+		void mouseMove(double x, double y);
+
+		/**
+		 * Closes the frame about to be rendered.
+		 */
+		void frame(double time, float delta);
+
+		unsigned long long getFrameCount() const;
+
+	private:
+		std::ofstream m_file;
+		std::string m_path;
+		unsigned long long m_frames;
+};
+
+/**
+ * Reads a recorded session back, frame by frame.
+ * The whole file is loaded when opened : a replay never waits for the disk.
+ */
+class SessionPlayer {
+
+	public:
+		SessionPlayer();
+
+		bool open(const std::string& path);
+		void stop();
+		bool isReplaying() const;
+
+		/**
+		 * False when every frame was replayed, which stops the replay.
+		 */
+		bool nextFrame(sessionFrame& frame);
+
+		const sessionState& getState() const;
+		size_t getFrameCount() const;
+		size_t getCurrentFrame() const;
+
+	private:
+		sessionState m_state;
+		std::vector<sessionFrame> m_frames;
+		size_t m_next;
+		bool m_replaying;
+};
@@ -9,15 +9,152 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+#include <cstdint>
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// uniform block binding point of the Globals block declared by the prelude
+#define GLOBALS_BINDING 0
 
 struct shader {
 	GLuint id = 0;
 	GLuint vertexId = 0;
 	GLuint fragmentId = 0;
+	bool animated = true;	// the user code reads fTime, fDelta or iFrame
+	bool readsMouse = true;	// the user code reads the mouse position or buttons
+	bool deepZoom = false;	// the user code reads iDeepZoom : it iterates the reference orbit past DEEP_ZOOM_THRESHOLD
+	uint64_t sourceKey = 0;	// hash of the sources it was built from (see programCacheKey)
 };
 
-bool loadShader(shader& shader, const std::string& name);
+/**
+ * Values of the uniforms a variant of a shader is compiled for (see #specialize), in declaration order.
+ * Empty for the generic program.
+ */
+typedef std::vector<std::pair<std::string, int>> shaderSpecialization;
+
+/**
+ * A program handed to the driver, not checked yet.
+ */
+struct pendingShader {
+	shader program;
+	bool cached = false;	// loaded from the program cache : nothing left to wait for
+};
+
+/**
+ * CPU mirror of the std140 Globals uniform block declared by the prelude of both stages.
+ * The mouse, keys and flags states are bitmasks, unpacked into the vb* arrays by the prelude.
+ */
+struct globalsBlock {
+	// only change with the resolution
+	glm::mat4 mvp;
+	glm::mat4 m;
+	glm::mat4 v;
+	glm::mat4 p;
+	// change every frame
+	glm::vec2 mouse;
+	glm::vec2 center;
+	glm::vec2 resolution;
+	GLfloat time;
+	GLfloat delta;
+	GLfloat ratio;
+	GLfloat zoom;
+	GLint increment;
+	GLint mode;
+	GLint mouseMask;
+	GLint keyMask;
+	GLint flagsMask;
+	GLfloat renderScale;	// internal resolution / window size (dynamic resolution)
+	GLint frame;			// frames rendered since the shader was loaded
+	GLint deepZoom;			// 1 when the reference orbit is used (perturbation)
+	glm::vec2 jitter;		// sub-pixel offset of fragCoord (temporal accumulation)
+	glm::vec2 deepOffset;	// view center - reference of the orbit
+	// the camera and the clock are doubles on the CPU : value = hi + lo
+	glm::vec2 centerLo;
+	GLfloat zoomLo;
+	GLfloat timeLo;
+	GLfloat timeWrapped;	// time modulo TIME_WRAP_PERIOD, precise whatever the uptime
+	GLfloat padding;		// std140 rounds the block size to 16 bytes
+};
+
+static_assert(sizeof(globalsBlock) == 368, "globalsBlock must match the std140 layout of the Globals block");
+
+/**
+ * Reads a shader file and expands its #include directives.
+ */
+bool readAndPrecomputeFile(const std::string& filepath, std::string& shaderContent);
+
+/**
+ * Builds the full source of the "VERTEX" or "FRAGMENT" stage of the given shader name :
+ * the injected prelude, with the preprocessed user code for the fragment stage.
+ */
+bool buildShaderSource(const std::string& type, const std::string& name, std::string& source);
+
+/**
+ * Turns the uniforms of the specialization into constants of the fragment source :
+ * "#define iMode 2" after the Globals block, so the driver folds the branches and the loop bounds on them.
+ */
+void specializeShaderSource(std::string& fragmentSource, const shaderSpecialization& specialization);
+bool compileShaderSource(GLuint& shader, const std::string& type, const std::string& source);
+bool compileShader(GLuint& shader, const std::string& type, const std::string& name);
+
+/**
+ * Links the already compiled vertex and fragment shaders into shader.id.
+ */
+bool linkShader(shader& shader);
+
+/**
+ * Whether the user code of a fragment source (built by buildShaderSource) uses one of the given identifiers.
+ * Members of a uniform block are always reported as active by the driver, so the source is scanned.
+ */
+bool readsIdentifiers(const std::string& fragmentSource, const std::vector<std::string>& identifiers);
+
+bool loadShader(shader& shader, const std::string& name, const shaderSpecialization& specialization = {});
+
+/**
+ * loadShader() in two steps, to load several shaders at once : beginLoadShader() returns as soon as
+ * the sources are handed to the driver, finishLoadShader() waits for the result and checks it.
+ * The driver compiles in parallel when it supports it (see enableParallelShaderCompile).
+ */
+bool beginLoadShader(pendingShader& pending, const std::string& name, const shaderSpecialization& specialization = {});
+bool finishLoadShader(pendingShader& pending, shader& shader);
+
+/**
+ * Whether finishLoadShader() would return without waiting.
+ * Always true without the parallel compile extension.
+ */
+bool isShaderLoaded(const pendingShader& pending);
+
+/**
+ * Lets the driver compile on its own threads (GL_KHR_parallel_shader_compile), for the current context.
+ */
+void enableParallelShaderCompile();
+
+/**
+ * Hash of the current sources of a shader, without compiling it. Matches shader.sourceKey when unchanged.
+ */
+bool shaderSourceKey(const std::string& name, uint64_t& key);
+
+/**
+ * Reads the #specialize directives of the last expansion of the given shader :
+ *
+ *     #specialize iMode iIncrement
+ *
+ * Only the integer uniforms that stay constant for long stretches can be specialized :
+ * iMode, iIncrement, iDeepZoom and iFlagsMask.
+ */
+bool parseSpecialization(const std::string& name, std::vector<std::string>& uniforms);
+
+/**
+ * Current value of a specializable uniform in the Globals block.
+ */
+int getSpecializationValue(const globalsBlock& block, const std::string& uniform);
+
+/**
+ * "iMode=2,iIncrement=0" : identifies a variant, and is readable in the logs.
+ */
+std::string specializationKey(const shaderSpecialization& specialization);
 void deleteShader(shader& shader);
 
 bool replaceFragmentShader(shader& shader, const std::string& name);
\ No newline at end of file
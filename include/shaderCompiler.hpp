@@ -0,0 +1,106 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shader.hpp"
+
+struct compileResult {
+	unsigned long long id = 0;
+	std::string name;
+	shaderSpecialization specialization;	// empty for the generic program
+	bool success = false;
+	shader program{};
+	double milliseconds = 0;	// preprocessing + compilation + link, on the worker
+	GLsync fence = nullptr;
+};
+
+/**
+ * Compiles and links shaders on a worker thread, in its own context
+ * sharing its objects with the rendering one, so the render loop never waits for the driver.
+ *
+ * A finished program is only handed back once a fence tells its GPU-side work is over,
+ * so it can be swapped in at a frame boundary right away.
+ */
+class ShaderCompiler {
+
+	public:
+		ShaderCompiler();
+		~ShaderCompiler();
+
+		/**
+		 * Starts the worker. makeCurrent is called on the worker thread to bind
+		 * the shared context, releaseCurrent when it stops.
+		 */
+		bool start(const std::function<bool()>& makeCurrent, const std::function<void()>& releaseCurrent);
+		void stop();
+		bool isRunning() const;
+
+		/**
+		 * Called on the worker thread every time a result is ready,
+		 * e.g. to wake up an event loop.
+		 */
+		void setNotifier(const std::function<void()>& notifier);
+
+		/**
+		 * Queues the compilation of a shader. If the same shader is already queued,
+		 * only the latest request is compiled.
+		 * Returns the request id, found back in the result.
+		 */
+		unsigned long long request(const std::string& name);
+
+		/**
+		 * Same, for a specialized variant of the shader.
+		 */
+		unsigned long long request(const std::string& name, const shaderSpecialization& specialization);
+
+		/**
+		 * Queues the compilation of several shaders at once : they are all handed to the driver
+		 * before any is waited for, so it can compile them in parallel.
+		 * Every result carries the returned id, in the order they finish.
+		 */
+		unsigned long long request(const std::vector<std::string>& names);
+
+		/**
+		 * Returns the oldest finished compilation whose GPU work is over, without waiting.
+		 * Must be called from the rendering thread.
+		 */
+		bool poll(compileResult& result);
+
+		/**
+		 * Whether a request is queued, being compiled, or waiting to be polled.
+		 */
+		bool isBusy() const;
+
+	private:
+		struct job {
+			unsigned long long id;
+			std::vector<std::string> names;
+			shaderSpecialization specialization;
+		};
+
+		unsigned long long enqueue(const std::vector<std::string>& names, const shaderSpecialization& specialization, bool coalesce);
+
+		void work(std::function<bool()> makeCurrent, std::function<void()> releaseCurrent);
+
+		std::thread m_thread;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<job> m_jobs;
+		std::deque<compileResult> m_results;
+		std::function<void()> m_notifier;
+		unsigned long long m_nextId;
+		unsigned int m_inProgress;
+		bool m_running;
+};
@@ -0,0 +1,73 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "shader.hpp"
+
+// programs kept linked, least recently used first out
+#define SHADER_LIBRARY_CAPACITY 64
+
+struct shaderLibraryStats {
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	unsigned long long stale = 0;		// found, but its sources changed since
+	unsigned long long evictions = 0;
+};
+
+/**
+ * Lists the shaders of a folder : the .frag files, as names relative to it without extension, sorted.
+ * Buffer passes (in a buffers/ folder) are skipped.
+ */
+std::vector<std::string> listShaders(const std::string& folder);
+
+/**
+ * Linked programs of the shaders loaded before, keyed by name and by the hash of their sources,
+ * so switching back to a shader skips the compilation entirely.
+ *
+ * A program is owned either by the library or by whoever took it out, never both :
+ * put() gives it to the library, take() gives it back.
+ */
+class ShaderLibrary {
+
+	public:
+		explicit ShaderLibrary(size_t capacity = SHADER_LIBRARY_CAPACITY);
+
+		/**
+		 * Takes the program of this shader out of the library if it was built from the given sources.
+		 * A stale one is deleted.
+		 */
+		bool take(const std::string& name, uint64_t sourceKey, shader& program);
+
+		/**
+		 * Gives a program to the library, replacing the previous one of the same name.
+		 * Evicts the least recently used ones past the capacity.
+		 */
+		void put(const std::string& name, const shader& program);
+
+		bool contains(const std::string& name) const;
+		size_t size() const;
+
+		/**
+		 * Deletes every program. Needs the context.
+		 */
+		void clear();
+
+		shaderLibraryStats getStats() const;
+
+	private:
+		struct entry {
+			shader program;
+			unsigned long long lastUse;
+		};
+
+		std::unordered_map<std::string, entry> m_entries;
+		size_t m_capacity;
+		unsigned long long m_clock;
+		shaderLibraryStats m_stats;
+};
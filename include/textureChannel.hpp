@@ -0,0 +1,133 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bufferPass.hpp"
+#include "threadPool.hpp"
+
+// iChannel0 to iChannel3
+#define MAX_TEXTURE_CHANNELS 4
+
+// iChannel0..3 are bound to the texture units after the buffers
+#define CHANNEL_TEXTURE_UNIT (BUFFER_TEXTURE_UNIT + MAX_BUFFER_PASSES)
+
+// #channel paths are relative to it
+#define TEXTURE_FOLDER "res/textures"
+
+/**
+ * An image input declared by the image shader with
+ *
+ *     #channel 0 <path/of/image.png>
+ *
+ * It is sampled through iChannel0..3 by every pass, the buffers included, with mipmaps and repeat wrapping.
+ * A channel samples black until its image is loaded.
+ */
+struct textureChannel {
+	unsigned int index = 0;
+	std::string path;		// relative to TEXTURE_FOLDER
+};
+
+/**
+ * Reads the #channel directives of the last expansion of the given image shader.
+ */
+bool parseTextureChannels(const std::string& shaderName, std::vector<textureChannel>& channels);
+
+struct textureCacheStats {
+	size_t textures = 0;
+	size_t bytes = 0;					// held on the GPU, mipmaps included
+	unsigned long long hits = 0;		// requested again, unchanged on disk
+	unsigned long long loads = 0;
+};
+
+/**
+ * Textures of the channels, keyed by path and kept across reloads and shader switches.
+ * A file is loaded again when its modification time changes, the previous texture is used meanwhile.
+ *
+ * Loading never blocks the render thread : the image is decoded on the pool, the pool copies it
+ * into a mapped pixel unpack buffer, and the render thread only issues the transfer and the mipmaps.
+ */
+class TextureCache {
+
+	public:
+		explicit TextureCache(ThreadPool& pool);
+
+		/**
+		 * Called from the pool when a step of a load is done, to wake the render loop up.
+		 */
+		void setNotifier(std::function<void()> notifier);
+
+		/**
+		 * Loads the file if it is not cached, or if it changed on disk.
+		 */
+		void request(const std::string& path);
+
+		/**
+		 * 0 until the file is loaded, or if it failed.
+		 */
+		GLuint get(const std::string& path) const;
+
+		/**
+		 * Advances the loads in flight, at a frame boundary. With wait, finishes all of them first (headless, replay).
+		 * Returns true if a texture changed.
+		 */
+		bool update(bool wait = false);
+
+		bool isLoading() const;
+
+		textureCacheStats getStats() const;
+
+		/**
+		 * Deletes every texture. Needs the context.
+		 */
+		void clear();
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		struct decodedImage {
+			bool ok = false;
+			unsigned int width = 0;
+			unsigned int height = 0;
+			std::shared_ptr<std::vector<unsigned char>> pixels;
+			double milliseconds = 0;
+		};
+
+		struct entry {
+			GLuint texture = 0;
+			unsigned int width = 0;
+			unsigned int height = 0;
+			size_t bytes = 0;
+			long long mtime = 0;				// of the file the texture, or the load in flight, comes from
+			bool failed = false;				// not loaded again until the file changes
+
+			clock::time_point requested;
+			std::future<decodedImage> decoding;
+			decodedImage image;
+			GLuint pbo = 0;						// mapped while the pool fills it
+			std::future<double> filling;		// ms
+		};
+
+		/**
+		 * Decoded : maps a buffer for it and lets the pool fill it.
+		 * Filled : creates the texture from the buffer.
+		 */
+		bool mapBuffer(const std::string& path, entry& texture);
+		bool uploadTexture(const std::string& path, entry& texture, double fillTime);
+
+		ThreadPool& m_pool;
+		std::function<void()> m_notifier;
+		std::unordered_map<std::string, entry> m_entries;
+		textureCacheStats m_stats;
+};
@@ -0,0 +1,67 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running CPU jobs (no GL context) in submission order.
+ */
+class ThreadPool {
+
+	public:
+		/**
+		 * 0 threads = one per hardware thread.
+		 */
+		explicit ThreadPool(unsigned int threads = 0);
+
+		/**
+		 * Runs the jobs still queued, then joins the workers.
+		 */
+		~ThreadPool();
+
+		unsigned int size() const;
+
+		/**
+		 * Queues a job. Its result, or its exception, is given by the future.
+		 */
+		template<typename F>
+		auto submit(F job) -> std::future<decltype(job())> {
+			using result = decltype(job());
+
+			// std::function must be copyable, a packaged_task is not
+			auto task = std::make_shared<std::packaged_task<result()>>(std::move(job));
+			std::future<result> future = task->get_future();
+
+			enqueue([task]() {
+				(*task)();
+			});
+
+			return future;
+		}
+
+		/**
+		 * Calls body(0) to body(count - 1) spread over the workers, and returns when all are done.
+		 * The calling thread takes part, so it can be called from a job of the pool itself.
+		 */
+		void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	private:
+		void enqueue(std::function<void()> job);
+		void work();
+
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<std::function<void()>> m_jobs;
+		bool m_running;
+};
@@ -0,0 +1,85 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// events kept per thread : the oldest ones are overwritten
+#define TRACE_RING_SIZE (1 << 17)
+
+// window written by F10 / --trace when --trace-seconds is not given
+#define TRACE_DEFAULT_SECONDS 10.0
+
+/**
+ * Scoped CPU zones, for Chrome's trace_event format (chrome://tracing, ui.perfetto.dev).
+ *
+ *     void App::update() {
+ *         TRACE_SCOPE("update");
+ *         ...
+ *     }
+ *
+ * Every thread writes into its own ring of TRACE_RING_SIZE events, allocated the first time it records :
+ * no lock nor allocation on the way. While disabled, a zone is a single relaxed atomic load.
+ * Zone names must be string literals (only the pointer is stored).
+ */
+
+extern std::atomic<bool> traceEnabled;
+
+void setTraceEnabled(bool enabled);
+
+inline bool isTraceEnabled() {
+	return traceEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Nanoseconds on the trace clock.
+ */
+int64_t traceNow();
+
+void traceZone(const char* name, int64_t start, int64_t end);
+
+/**
+ * A value over time, e.g. the GPU frame time, shown as a graph.
+ */
+void traceCounter(const char* name, double value);
+
+/**
+ * Name of the calling thread in the trace. Cheap, can be called before tracing is enabled.
+ */
+void setTraceThreadName(const std::string& name);
+
+/**
+ * Writes the events of every thread recorded in the last given seconds as trace_event JSON.
+ */
+bool writeTrace(const std::string& path, double seconds);
+
+class TraceScope {
+
+	public:
+		explicit TraceScope(const char* name) :
+			m_name(name),
+			m_start(isTraceEnabled() ? traceNow() : -1)
+		{
+		}
+
+		~TraceScope() {
+			if (m_start >= 0) {
+				traceZone(m_name, m_start, traceNow());
+			}
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		const char* m_name;
+		int64_t m_start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -0,0 +1,48 @@
+/**
+ * @author NoxFly
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+#define UNIFORM_RING_SLOTS 3
+
+/**
+ * Uniform buffer, persistently mapped and split into UNIFORM_RING_SLOTS slots :
+ * the CPU writes the slot of frame N while the GPU still reads the ones of N-1 and N-2.
+ * Every slot is protected by a fence, so a slot is only rewritten once the GPU is done with it.
+ *
+ * Only the bytes marked as changed are copied, each slot catching up
+ * with the changes it missed the next time it is used.
+ */
+struct uniformRing {
+	GLuint buffer = 0;
+	unsigned char* mapped = nullptr;
+	GLsizeiptr size = 0;			// size of the block
+	GLsizeiptr stride = 0;			// size of a slot, aligned for glBindBufferRange
+	GLsync fences[UNIFORM_RING_SLOTS] = {};
+	GLsizeiptr dirtyBegin[UNIFORM_RING_SLOTS] = {};
+	GLsizeiptr dirtyEnd[UNIFORM_RING_SLOTS] = {};
+	unsigned int slot = 0;
+	unsigned long long stalls = 0;	// times the CPU had to wait for the GPU to release a slot
+};
+
+bool createUniformRing(uniformRing& ring, GLsizeiptr size);
+void deleteUniformRing(uniformRing& ring);
+
+/**
+ * Marks a byte range of the block as changed, in every slot.
+ */
+void markUniformRing(uniformRing& ring, GLsizeiptr offset, GLsizeiptr size);
+
+/**
+ * Moves to the next slot, copies the changed bytes of data into it,
+ * and binds it to the given uniform block binding point.
+ */
+void uploadUniformRing(uniformRing& ring, const void* data, GLuint binding);
+
+/**
+ * To call once the draw calls reading the current slot have been issued.
+ */
+void fenceUniformRing(uniformRing& ring);
@@ -6,6 +6,7 @@
 
 #include <string_view>
 #include <string>
+#include <cstdint>
 
 /**
  * Removes the leading whitespaces from a string.
@@ -35,4 +36,17 @@ std::string trim(const std::string& str);
  * @param replace The substring to replace by
  * @return The modified string
  */
-std::string replace(const std::string& str, const std::string& find, const std::string& replace);
\ No newline at end of file
+std::string replace(const std::string& str, const std::string& find, const std::string& replace);
+
+/**
+ * 64-bit FNV-1a hash of the given data.
+ * @param data The data to hash
+ * @param seed The hash to continue from, to hash several strings as one
+ * @return The hash
+ */
+uint64_t hash64(std::string_view data, uint64_t seed = 0xcbf29ce484222325ull);
+
+/**
+ * Formats a 64-bit value as 16 hexadecimal characters.
+ */
+std::string toHex(uint64_t value);
\ No newline at end of file
@@ -4,37 +4,124 @@
 
 #include <App.hpp>
 
+#include <chrono>
+#include <filesystem>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
 static void error_callback(int error, const char* description) {
 	fprintf(stderr, "GLFW Error: %s\n", description);
 }
 
-App::App() :
+// unlike glfwGetTime(), not affected by glfwSetTime() on reset
+static double getTimerSeconds() {
+	return (double)glfwGetTimerValue() / (double)glfwGetTimerFrequency();
+}
+
+App::App(const options& opts) :
+	m_options(opts),
 	m_windowMode(windowMode::WINDOWED),
 	m_window(nullptr),
-	m_windowWidth(1280),
-	m_windowHeight(720),
+	m_headlessContext{},
+	m_offscreen{},
+	m_windowWidth(opts.width),
+	m_windowHeight(opts.height),
 	m_realWidth(m_windowWidth),
 	m_realHeight(m_windowHeight),
 	m_frustrum{ 90.f, (float)m_windowWidth / (float)m_windowHeight, 0.1f, 1000.f },
 	m_shader{},
 	m_surface{ 0, 0 },
+	m_buffers(),
+	m_targetPool{},
+	m_frame(0),
+	m_compilerWindow(nullptr),
+	m_reloadRequest(0),
+	m_reloadStart(0),
+	m_reloadCompileTime(0),
+	m_reloadSwapped(false),
 	m_fractalName("loop"),
 	m_uniforms{},
 	m_mvp{},
 	m_fps{},
+	m_stats{},
 	m_zooming(0),
 	m_displacement(0, 0),
 	m_vsync(true),
 	m_needEscape(false),
+	m_redraw(true),
+	m_dynamicResolution(opts.targetFrameTime > 0),
+	m_targetFrameTime(opts.targetFrameTime > 0 ? opts.targetFrameTime : DEFAULT_TARGET_FRAME_TIME),
+	m_renderScale(1.0f),
+	m_scaledTarget{},
+	m_lastScaledSample(0),
+	m_tiled(opts.tiled),
+	m_tiledTarget{},
+	m_tiles(),
+	m_nextTile(0),
+	m_tilesPerFrame(1),
+	m_tiledTime(0),
+	m_tiledState{},
+	m_tiledQuery(0),
+	m_tiledQueryTiles(0),
+	m_tiledQueryPending(false),
+	m_tiledDrawing(false),
+	m_accumulationSamples(opts.accumulate),
+	m_accumulated(0),
+	m_accumulationTarget{},
+	m_accumulationState{},
+	m_jitter(0, 0),
 	m_mouseFlagsUniforms{},
 	m_boolFlagsUniforms{},
 	m_keySpecialFlagsUniforms{},
 	m_keyTabUniform(0),
-	m_mouseFragLoc(-1),
-	m_keysFragLoc(-1),
-	m_flagsFragLoc(-1),
-	m_keyTabFragLoc(-1)
+	m_globals{},
+	m_globalsRing{},
+	m_centerX{},
+	m_centerY{},
+	m_zoom(1.0),
+	m_time(0),
+	m_threadPool(),
+	m_orbit{},
+	m_orbitTask(),
+	m_orbitBuffer(0),
+	m_capture(m_threadPool),
+	m_textures(m_threadPool),
+	m_channels(),
+	m_limiter(),
+	m_clockFrame(0),
+	m_recorder(),
+	m_player(),
+	m_replayStart(0),
+	m_library(),
+	m_libraryNames(),
+	m_libraryRequest(0),
+	m_libraryPending(0),
+	m_specialized(),
+	m_variants(),
+	m_variantRequest(0),
+	m_variantClock(0),
+	m_program(0),
+	m_console(),
+	m_visible(false),
+	m_quit(false),
+	m_screenshotPath(),
+	m_screenshotCommand()
 {
+	m_limiter.setTargetFps(opts.targetFps);
+
+	// a finished load wakes up the idle loop
+	if (!opts.headless) {
+		m_textures.setNotifier([]() {
+			glfwPostEmptyEvent();
+		});
+	}
+
+	if (!opts.tracePath.empty()) {
+		setTraceEnabled(true);
+	}
+
 	glfwSetErrorCallback(error_callback);
 	init();
 }
@@ -44,12 +131,30 @@ App::~App() {
 }
 
 void App::init() {
-	initGLFW();
-	createWindow();
-	refreshResolution();
-	initGLEW();
+	if (m_options.headless) {
+		initHeadless();
+	}
+	else {
+		initGLFW();
+		createWindow();
+		refreshResolution();
+		initGLEW();
+		initShaderCompiler();
+	}
+
 	initSurface();
 
+	if (!createUniformRing(m_globalsRing, sizeof(globalsBlock))) {
+		std::cerr << "Failed to create the uniform buffer" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	createGpuTimer(m_stats.timer);
+
+	if (!m_options.programCacheDir.empty()) {
+		initProgramCache(m_options.programCacheDir, m_options.programCacheSize);
+	}
+
 	for (unsigned int i = 0; i < MOUSE_BTN_COUNT; i++) {
 		m_mouseFlagsUniforms[i] = GL_FALSE;
 	}
@@ -61,9 +166,33 @@ void App::init() {
 	for (unsigned int i = 0; i < KEY_SPECIAL_COUNT; i++) {
 		m_keySpecialFlagsUniforms[i] = GL_FALSE;
 	}
+
+	if (m_options.library && !m_options.headless) {
+		precompileLibrary();
+	}
 }
 
 void App::close() {
+	// the worker's context shares the window's objects : stop it first
+	m_compiler.stop();
+
+	// needs the context for its last readbacks
+	m_capture.stop();
+
+	// may wake up the event loop when done
+	if (m_orbitTask.valid()) {
+		m_orbitTask.wait();
+		m_orbitTask = {};
+	}
+
+	m_orbit = {};
+	deleteReferenceOrbitBuffer(m_orbitBuffer);
+
+	if (m_compilerWindow != nullptr) {
+		glfwDestroyWindow(m_compilerWindow);
+		m_compilerWindow = nullptr;
+	}
+
 	if (m_surface.VAO > 0) {
 		glDeleteVertexArrays(1, &m_surface.VAO);
 	}
@@ -72,70 +201,193 @@ void App::close() {
 		glDeleteBuffers(1, &m_surface.VBO);
 	}
 
+	clearVariants();
 	deleteShader(m_shader);
+	deleteBufferPasses(m_buffers, m_targetPool);
+	m_textures.clear();
+	m_channels.clear();
+	m_library.clear();
+	m_libraryRequest = 0;
+	m_libraryPending = 0;
+	clearRenderTargetPool(m_targetPool);
+	deleteUniformRing(m_globalsRing);
+	deleteRenderTarget(m_offscreen);
+	deleteRenderTarget(m_scaledTarget);
+	deleteRenderTarget(m_tiledTarget);
+	deleteRenderTarget(m_accumulationTarget);
+
+	if (m_tiledQuery > 0) {
+		glDeleteQueries(1, &m_tiledQuery);
+		m_tiledQuery = 0;
+	}
+
+	m_tiles.clear();
+	m_tiledQueryPending = false;
+	deleteGpuTimer(m_stats.timer);
+
+	if (m_options.headless) {
+		destroyHeadlessContext(m_headlessContext);
+		return;
+	}
 
 	if (m_window != nullptr) {
 		glfwDestroyWindow(m_window);
+		m_window = nullptr;
 	}
 
 	glfwTerminate();
 }
 
 bool App::loadFractal(const std::string& name) {
+	// finished background compilations can be taken from the library right away
+	pollShaderCompiler();
+	shelveShaders();
+
 	m_fractalName = name;
 	return initShader();
 }
 
 void App::run() {
-	m_needEscape = false;
-
-	refreshResolution();
-	reset();
+	m_quit = false;
 
-	m_fps.currentTime = (float)glfwGetTime();
-	m_fps.lastFrame = 0;
+	// commands wake the event loop up, even while the window is hidden
+	m_console.setNotifier([]() {
+		glfwPostEmptyEvent();
+	});
 
-	m_uniforms.delta.value.f = 0;
-	m_uniforms.zoom.value.f = 1.0f;
-	m_uniforms.center.value.v2 = glm::vec2(0.0f, 0.0f);
+	m_console.start(m_options.socketPath);
 
-	glfwShowWindow(m_window);
+	// --shader, loaded beforehand
+	if (m_shader.id != 0) {
+		showWindow();
+	}
 
-	while (!glfwWindowShouldClose(m_window) && !m_needEscape)
+	while (!m_quit)
 	{
+		// frame boundary : commands change the state between two frames only
+		pollConsole();
+
+		if (m_quit) {
+			break;
+		}
+
+		if (m_visible && (glfwWindowShouldClose(m_window) || m_needEscape)) {
+			hideWindow();
+		}
+
+		// back to the console : nothing to render until the next load
+		if (!m_visible) {
+			pollShaderCompiler();
+			glfwWaitEvents();
+			continue;
+		}
+
+		TRACE_SCOPE("frame");
+
+		// a shader file changed on disk
+		if (m_options.watch && m_watcher.poll()) {
+			refreshShader();
+		}
+
+		// frame boundary : a finished reload can replace the program, a loaded image can be bound
+		pollShaderCompiler();
+		pollTextures();
+
+		if (isIdle()) {
+			TRACE_SCOPE("idle");
+
+			// nothing would change on screen : sleep until an event.
+			// The compiler wakes us up itself, the file watcher is polled a few times per second.
+			if (m_options.watch) {
+				glfwWaitEventsTimeout(0.1);
+			}
+			else {
+				glfwWaitEvents();
+			}
+
+			// the time slept is not part of the next frame
+			m_fps.lastFrame = glfwGetTime();
+			m_limiter.reset();
+			continue;
+		}
+
+		m_redraw = false;
+
 		// update
 		updateFPS();
 
+		if (m_player.isReplaying() && !replayFrame()) {
+			finishReplay();
+			continue;
+		}
+
+		// closes the events handled since the last frame
+		m_recorder.frame(m_time, m_uniforms.delta.f);
 
-		if (m_zooming != 0) {
-			m_uniforms.zoom.value.f *= std::pow(1.02f, m_zooming);
+		update();
+
+		// render
+		{
+			TRACE_SCOPE("render");
+
+			beginGpuTimer(m_stats.timer);
+
+			// a replay renders every frame completely, at full resolution : the same frames on any machine
+			if (m_player.isReplaying()) {
+				render();
+			}
+			else if (m_tiled) {
+				renderTiled();
+			}
+			else if (m_dynamicResolution) {
+				renderScaled();
+			}
+			else if (m_accumulationSamples > 0 && canAccumulate()) {
+				renderAccumulated();
+			}
+			else {
+				render();
+			}
+
+			endGpuTimer(m_stats.timer);
 		}
 
-		if (m_displacement.x != 0) {
-			m_uniforms.center.value.v2.x += m_displacement.x * 0.01f / m_uniforms.zoom.value.f;
+		// reads the back buffer, before it is swapped
+		if (m_capture.isCapturing()) {
+			TRACE_SCOPE("capture");
+			captureFrame();
 		}
 
-		if (m_displacement.y != 0) {
-			m_uniforms.center.value.v2.y += m_displacement.y * 0.01f / m_uniforms.zoom.value.f;
+		if (!m_screenshotPath.empty()) {
+			saveScreenshot();
 		}
 
-		// render
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		{
+			TRACE_SCOPE("swap");
+			glfwSwapBuffers(m_window);
+		}
 
-		glUseProgram(m_shader.id);
-		glBindVertexArray(m_surface.VAO);
+		if (m_reloadSwapped) {
+			m_reloadSwapped = false;
 
-		sendUniforms();
+			std::cout << "[Reload] " << m_fractalName << " : first frame after "
+				<< std::fixed << std::setprecision(1) << (getTimerSeconds() - m_reloadStart) * 1000.0
+				<< " ms (compile + link " << m_reloadCompileTime << " ms)" << std::defaultfloat << std::endl;
+		}
 
-		//glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		{
+			TRACE_SCOPE("poll events");
+			glfwPollEvents();
+		}
 
-		glBindVertexArray(0);
-		glUseProgram(0);
+		collectFrameStats(m_stats);
 
-		glfwSwapBuffers(m_window);
-		glfwPollEvents();
+		if (m_dynamicResolution && !m_player.isReplaying()) {
+			updateRenderScale();
+		}
+
+		// --fps : sleeps until the next frame is due
+		m_limiter.wait();
 
 		// This is for debug purpose only
 		// it is spamming "1282" error code in certain cases
@@ -147,53 +399,1365 @@ void App::run() {
 		}*/
 	}
 
-	if (m_needEscape) {
-		glfwHideWindow(m_window);
+	hideWindow();
+	m_console.stop();
+
+	if (!m_options.tracePath.empty()) {
+		writeTrace(m_options.tracePath, m_options.traceSeconds);
+	}
+}
+
+void App::showWindow() {
+	m_needEscape = false;
+
+	refreshResolution();
+	reset();
+
+	m_fps.currentTime = glfwGetTime();
+	m_fps.lastFrame = m_fps.currentTime;
+	m_fps.lastTime = m_fps.currentTime;
+	m_fps.nbFrames = 0;
+
+	m_limiter.reset();
+
+	clearFrameStats();
+
+	m_uniforms.delta.f = 0;
+
+	glfwShowWindow(m_window);
+
+	m_visible = true;
+	m_redraw = true;
+
+	if (!m_options.captureOutput.empty()) {
+		startCapture();
+	}
+
+	if (!m_options.replayPath.empty()) {
+		startReplay();
+	}
+	else if (!m_options.recordPath.empty()) {
+		m_recorder.start(m_options.recordPath, getSessionState());
+	}
+}
+
+void App::hideWindow() {
+	if (!m_visible) {
+		return;
+	}
+
+	m_visible = false;
+
+	if (!m_options.statsPath.empty()) {
+		dumpFrameStats(m_options.statsPath, m_stats);
+	}
+
+	m_capture.stop();
+	m_recorder.stop();
+	m_player.stop();
+
+	// the keys held down will not be released in the window anymore
+	m_zooming = 0;
+	m_displacement = glm::vec2(0, 0);
+
+	m_needEscape = false;
+	glfwSetWindowShouldClose(m_window, GLFW_FALSE);
+	glfwHideWindow(m_window);
+
+	if (!m_screenshotPath.empty()) {
+		m_console.reply(m_screenshotCommand, "The window was hidden before the screenshot", true);
+		m_screenshotPath.clear();
+		m_screenshotCommand = {};
+	}
+}
+
+void App::pollConsole() {
+	consoleCommand command;
+
+	while (!m_quit && m_console.poll(command)) {
+		runCommand(command);
+	}
+}
+
+void App::runCommand(const consoleCommand& command) {
+	const std::string& name = command.name;
+	const std::vector<std::string>& args = command.args;
+
+	// the commands are not session events : a session they changed would not replay the same
+	auto refuseInSession = [&]() {
+		if (!m_recorder.isRecording() && !m_player.isReplaying()) {
+			return false;
+		}
+
+		m_console.reply(command, std::string(m_player.isReplaying() ? "A session is replaying" : "A session is being recorded")
+			+ ", hide the window first", true);
+
+		return true;
+	};
+
+	if (name == "quit" || name == "exit") {
+		m_quit = true;
+
+		// no prompt after the last command
+		if (command.client != nullptr) {
+			m_console.reply(command, "");
+		}
+	}
+	else if (name == "help") {
+		m_console.reply(command,
+			"load <name>               Load a shader of res/shaders/ (the name alone works too) and show the window.\n"
+			"reload                    Recompile the current shader.\n"
+			"set <uniform> <value...>  Set iIncrement, iMode, iFlagsMask, fZoom or fvCenter <x> <y>.\n"
+			"screenshot [file.png]     Write the next frame (default " DEFAULT_SCREENSHOT_FILE ").\n"
+			"show / hide               Show or hide the window.\n"
+			"quit / exit               Quit.");
+	}
+	else if (name == "reload") {
+		if (refuseInSession()) {
+			return;
+		}
+
+		if (m_shader.id == 0) {
+			m_console.reply(command, "No shader loaded", true);
+			return;
+		}
+
+		refreshShader();
+		m_console.reply(command, "");
+	}
+	else if (name == "set") {
+		if (refuseInSession()) {
+			return;
+		}
+
+		std::string error;
+
+		if (setUniform(args, error)) {
+			m_console.reply(command, "");
+		}
+		else {
+			m_console.reply(command, error, true);
+		}
+	}
+	else if (name == "screenshot") {
+		if (!m_visible) {
+			m_console.reply(command, "The window is hidden", true);
+		}
+		else if (!m_screenshotPath.empty()) {
+			m_console.reply(command, "A screenshot is already pending", true);
+		}
+		else {
+			// answered once the next frame is written
+			m_screenshotPath = args.empty() ? DEFAULT_SCREENSHOT_FILE : args[0];
+			m_screenshotCommand = command;
+			m_redraw = true;
+		}
+	}
+	else if (name == "show") {
+		if (m_shader.id == 0) {
+			m_console.reply(command, "No shader loaded", true);
+			return;
+		}
+
+		if (!m_visible) {
+			showWindow();
+		}
+
+		m_console.reply(command, "");
+	}
+	else if (name == "hide") {
+		hideWindow();
+		m_console.reply(command, "");
+	}
+	else if (name == "load" || args.empty()) {
+		if (refuseInSession()) {
+			return;
+		}
+
+		// or the name alone, as the prompt used to take it
+		const std::string shaderName = name == "load" ? (args.empty() ? "" : args[0]) : name;
+		const std::string previous = m_fractalName;
+		const bool loaded = m_shader.id != 0;
+
+		if (shaderName.empty() || !loadFractal(shaderName)) {
+			// the window keeps rendering the previous one
+			if (m_visible && loaded) {
+				loadFractal(previous);
+			}
+
+			m_console.reply(command, "Fractal not found.", true);
+			return;
+		}
+
+		if (m_visible) {
+			m_redraw = true;
+		}
+		else {
+			showWindow();
+		}
+
+		m_console.reply(command, "");
 	}
 	else {
-		close();
-		init();
+		m_console.reply(command, "Unknown command " + name + ", type help", true);
 	}
 }
 
-void App::updateFPS() {
-	// Time update
-	m_fps.currentTime = (float)glfwGetTime();
-	m_uniforms.time.value.f = m_fps.currentTime;
+bool App::setUniform(const std::vector<std::string>& args, std::string& error) {
+	if (args.empty()) {
+		error = "Usage : set <uniform> <value...>";
+		return false;
+	}
 
-	// delta update
-	m_uniforms.delta.value.f = m_fps.currentTime - m_fps.lastTime;
+	const std::string& uniform = args[0];
+	std::vector<double> values;
 
-	// nbFrame counter update
-	m_fps.nbFrames++;
+	for (size_t i = 1; i < args.size(); i++) {
+		char* end;
+		const double value = std::strtod(args[i].c_str(), &end);
+
+		if (end == args[i].c_str() || *end != '\0') {
+			error = "Invalid value \"" + args[i] + "\"";
+			return false;
+		}
+
+		values.push_back(value);
+	}
+
+	if (uniform != "iIncrement" && uniform != "iMode" && uniform != "iFlagsMask" && uniform != "fZoom" && uniform != "fvCenter") {
+		error = "Cannot set " + uniform + " (iIncrement, iMode, iFlagsMask, fZoom, fvCenter)";
+		return false;
+	}
+
+	const size_t count = uniform == "fvCenter" ? 2 : 1;
+
+	if (values.size() != count) {
+		error = uniform + " takes " + std::to_string(count) + (count > 1 ? " values" : " value");
+		return false;
+	}
+
+	if (uniform == "iIncrement") {
+		m_uniforms.increment.i = (int)values[0];
+	}
+	else if (uniform == "iMode") {
+		m_keyTabUniform = (int)values[0];
+	}
+	else if (uniform == "iFlagsMask") {
+		for (unsigned int i = 0; i < KEY_FLAGS_COUNT; i++) {
+			m_boolFlagsUniforms[i] = ((int)values[0] >> i) & 1 ? GL_TRUE : GL_FALSE;
+		}
+	}
+	else if (uniform == "fZoom") {
+		if (values[0] <= 0) {
+			error = "The zoom must be positive";
+			return false;
+		}
+
+		m_zoom = m_shader.deepZoom ? std::min(values[0], DEEP_ZOOM_MAX) : values[0];
+	}
+	else {
+		m_centerX = { values[0], 0 };
+		m_centerY = { values[1], 0 };
+	}
+
+	m_redraw = true;
+
+	return true;
+}
+
+void App::saveScreenshot() {
+	std::vector<unsigned char> pixels((size_t)m_realWidth * m_realHeight * 4);
+
+	// the capture reads through pixel pack buffers
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, m_realWidth, m_realHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	if (writePNG(m_screenshotPath, pixels.data(), m_realWidth, m_realHeight)) {
+		m_console.reply(m_screenshotCommand, "Screenshot written to " + m_screenshotPath);
+	}
+	else {
+		m_console.reply(m_screenshotCommand, "Cannot write " + m_screenshotPath, true);
+	}
+
+	m_screenshotPath.clear();
+	m_screenshotCommand = {};
+}
+
+void App::runHeadless() {
+	reset();
+	clearFrameStats();
+
+	// the session sets the resolution, the clock and the number of frames
+	const bool replay = !m_options.replayPath.empty();
+
+	if (replay && !startReplay()) {
+		return;
+	}
+
+	const unsigned int frameCount = replay ? (unsigned int)m_player.getFrameCount() : m_options.frameCount;
+	const double dt = m_options.fixedDelta;
+	const bool dump = !m_options.outputDir.empty();
+
+	// the frames themselves may go to stdout
+	std::ostream& log = m_options.outputDir == "-" ? std::cerr : std::cout;
+
+	// every frame is kept : the renderer waits for the encoders rather than dropping
+	if (dump && !m_capture.start(m_options.outputDir, m_options.outputFormat, m_realWidth, m_realHeight, 1.0 / dt, false)) {
+		return;
+	}
+
+	using clock = std::chrono::steady_clock;
+
+	// the encoding and the disk writes are not counted, only the rendering and the queued readbacks
+	clock::duration renderTime(0);
+
+	for (unsigned int i = 0; i < frameCount; i++) {
+		TRACE_SCOPE("frame");
+
+		const auto frameStart = clock::now();
+
+		if (replay) {
+			// recorded clock, recorded input
+			replayFrame();
+			renderOffscreenFrame(m_time, m_uniforms.delta.f);
+		}
+		else {
+			// fixed timestep : frame i is always rendered at i * dt
+			renderOffscreenFrame(i * dt, dt);
+		}
+
+		if (dump) {
+			TRACE_SCOPE("capture");
+			m_capture.capture(m_offscreen.fbo);
+		}
+
+		const auto frameTime = clock::now() - frameStart;
+
+		renderTime += frameTime;
+		pushSample(m_stats.cpu, std::chrono::duration<double, std::milli>(frameTime).count());
+	}
+
+	const auto finishStart = clock::now();
+	glFinish();
+	renderTime += clock::now() - finishStart;
+
+	m_capture.stop();
+	m_player.stop();
+
+	const double seconds = std::chrono::duration<double>(renderTime).count();
+	const double fps = frameCount / seconds;
+	const double mpixels = fps * m_realWidth * m_realHeight / 1e6;
+
+	log << "Rendered " << frameCount << " frames of " << m_fractalName
+		<< " at " << m_realWidth << "x" << m_realHeight
+		<< " in " << std::fixed << std::setprecision(3) << seconds << " s\n"
+		<< "  " << std::setprecision(1) << fps << " frames/s, "
+		<< std::setprecision(1) << mpixels << " Mpixel/s" << std::endl;
+
+	flushFrameStats();
+	writeFrameStats(log, m_stats);
+
+	if (!m_options.statsPath.empty() && m_options.statsPath != "-") {
+		dumpFrameStats(m_options.statsPath, m_stats);
+	}
+
+	if (!m_options.tracePath.empty()) {
+		writeTrace(m_options.tracePath, m_options.traceSeconds);
+	}
+}
+
+void App::renderOffscreenFrame(double time, double delta) {
+	m_time = time;
+	m_uniforms.delta.f = (float)delta;
+
+	pollTextures();
+	update();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_offscreen.fbo);
+
+	{
+		TRACE_SCOPE("render");
+
+		beginGpuTimer(m_stats.timer);
+		render();
+		endGpuTimer(m_stats.timer);
+	}
+
+	collectFrameStats(m_stats);
+}
+
+bool App::readOffscreenPixels(std::vector<unsigned char>& pixels) {
+	if (!m_options.headless) {
+		return false;
+	}
+
+	pixels.resize((size_t)m_realWidth * m_realHeight * 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_offscreen.fbo);
+	glReadPixels(0, 0, m_realWidth, m_realHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	return true;
+}
+
+bool App::setOffscreenSize(unsigned int width, unsigned int height) {
+	if (!m_options.headless) {
+		return false;
+	}
+
+	if (width == m_offscreen.width && height == m_offscreen.height) {
+		return true;
+	}
+
+	if (!createRenderTarget(m_offscreen, width, height)) {
+		return false;
+	}
+
+	m_windowWidth = width;
+	m_windowHeight = height;
+	m_realWidth = width;
+	m_realHeight = height;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_offscreen.fbo);
+
+	refreshResolution();
+	refreshSurface();
+
+	return true;
+}
+
+void App::update() {
+	TRACE_SCOPE("update");
+
+	if (m_zooming != 0) {
+		m_zoom *= std::pow(1.02, m_zooming);
+
+		if (m_shader.deepZoom) {
+			m_zoom = std::min(m_zoom, DEEP_ZOOM_MAX);
+		}
+	}
+
+	// the steps become far smaller than a float ulp of the center when zoomed in
+	if (m_displacement.x != 0) {
+		m_centerX = ddAdd(m_centerX, m_displacement.x * 0.01 / m_zoom);
+	}
+
+	if (m_displacement.y != 0) {
+		m_centerY = ddAdd(m_centerY, m_displacement.y * 0.01 / m_zoom);
+	}
+
+	updateReferenceOrbit();
+
+	// after the orbit : iDeepZoom may be specialized
+	updateVariant();
+}
+
+void App::updateReferenceOrbit() {
+	// computed ahead of the threshold, so it is usually ready when it is needed
+	if (!m_shader.deepZoom || m_zoom < DEEP_ZOOM_THRESHOLD * 0.1) {
+		return;
+	}
+
+	// headless or replay : every frame renders with the complete orbit, for reproducible output
+	const bool wait = m_options.headless || m_player.isReplaying();
+	const bool notify = !m_options.headless;
+
+	ThreadPool* pool = &m_threadPool;
+
+	while (true) {
+		if (m_orbitTask.valid()) {
+			if (!wait && m_orbitTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				return;
+			}
+
+			referenceOrbit orbit = m_orbitTask.get();
+
+			if (!uploadReferenceOrbit(m_orbitBuffer, orbit)) {
+				return;
+			}
+
+			// the GPU has the points
+			orbit.first = orbit.length();
+			orbit.points.clear();
+
+			m_orbit = std::move(orbit);
+			m_redraw = true;
+		}
+
+		if (!isReferenceOrbitValid(m_orbit, m_centerX, m_centerY, m_zoom)) {
+			const doubleDouble x = m_centerX;
+			const doubleDouble y = m_centerY;
+			const double zoom = m_zoom;
+
+			m_orbitTask = m_threadPool.submit([pool, x, y, zoom, notify]() {
+				referenceOrbit orbit = computeReferenceOrbit(x, y, zoom, *pool);
+
+				if (notify) {
+					glfwPostEmptyEvent();
+				}
+
+				return orbit;
+			});
+		}
+		else if (!m_orbit.escaped && m_orbit.length() < REFERENCE_ORBIT_MAX_LENGTH) {
+			referenceOrbit orbit = m_orbit;
+
+			m_orbitTask = m_threadPool.submit([orbit, notify]() mutable {
+				extendReferenceOrbit(orbit, REFERENCE_ORBIT_CHUNK);
+
+				if (notify) {
+					glfwPostEmptyEvent();
+				}
+
+				return orbit;
+			});
+		}
+		else {
+			return;
+		}
+
+		if (!wait) {
+			return;
+		}
+	}
+}
+
+bool App::isDeepZoom() const {
+	// a reference left behind by the view is still correct, only less precise, until the new one is ready
+	return m_shader.deepZoom && m_zoom >= DEEP_ZOOM_THRESHOLD && m_orbit.length() > 1;
+}
+
+void App::render(bool clear) {
+	glBindVertexArray(m_surface.VAO);
+
+	// once for every pass of the frame
+	sendUniforms();
+
+	// the buffers read them too
+	bindTextureChannels();
+
+	if (!m_buffers.empty()) {
+		renderBufferPasses();
+	}
+
+	if (clear) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	glUseProgram(m_program);
+
+	{
+		TRACE_SCOPE("draw");
+
+		//glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	// the slot written by sendUniforms() is in use until this draw is done
+	fenceUniformRing(m_globalsRing);
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	m_frame++;
+}
+
+void App::renderBufferPasses() {
+	TRACE_SCOPE("buffer passes");
+
+	// the image pass goes wherever the caller bound
+	GLint framebuffer = 0;
+	GLint viewport[4];
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	int w, h;
+
+	getSurfaceSize(w, h);
+
+	for (bufferPass& pass : m_buffers) {
+		if (!resizeBufferPass(pass, m_targetPool, w, h)) {
+			continue;
+		}
+
+		// reads the latest frame of every buffer, this one's included, and writes the other target
+		bindBufferTextures(m_buffers);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.targets[1 - pass.current].fbo);
+		glViewport(0, 0, w, h);
+
+		glUseProgram(pass.program.id);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		pass.current = 1 - pass.current;
+	}
+
+	// the image reads what has just been rendered
+	bindBufferTextures(m_buffers);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+bool App::loadBufferPasses() {
+	deleteBufferPasses(m_buffers, m_targetPool);
+	unbindBufferTextures();
+
+	std::vector<bufferPass> passes;
+
+	if (!parseBufferPasses(m_fractalName, passes)) {
+		return false;
+	}
+
+	for (bufferPass& pass : passes) {
+		if (!loadLibraryShader(pass.program, pass.shaderName)) {
+			std::cerr << "Error: failed to load buffer " << (char)('A' + pass.index) << " (" << pass.shaderName << ")" << std::endl;
+			deleteBufferPasses(passes, m_targetPool);
+			return false;
+		}
+	}
+
+	m_buffers = std::move(passes);
+
+	if (!m_buffers.empty()) {
+		// both work on the image only
+		if (m_dynamicResolution) {
+			toggleDynamicResolution();
+		}
+
+		if (m_tiled) {
+			toggleTiled();
+		}
+	}
+
+	return true;
+}
+
+void App::loadTextureChannels() {
+	std::vector<textureChannel> channels;
+
+	// a bad declaration only costs the textures
+	if (!parseTextureChannels(m_fractalName, channels)) {
+		channels.clear();
+	}
+
+	// unchanged files come from the cache
+	for (const textureChannel& channel : channels) {
+		m_textures.request(channel.path);
+	}
+
+	const bool changed = !std::equal(channels.begin(), channels.end(), m_channels.begin(), m_channels.end(),
+		[](const textureChannel& a, const textureChannel& b) {
+			return a.index == b.index && a.path == b.path;
+		});
+
+	m_channels = std::move(channels);
+
+	if (changed) {
+		watchShaderFiles();
+	}
+}
+
+void App::pollTextures() {
+	TRACE_SCOPE("poll textures");
+
+	// headless or replay : every frame renders with its images, for reproducible output
+	const bool wait = m_options.headless || m_player.isReplaying();
+
+	if (m_textures.update(wait)) {
+		// the shader sees another input
+		restartStillImage();
+		m_redraw = true;
+	}
+}
+
+void App::bindTextureChannels() {
+	GLuint textures[MAX_TEXTURE_CHANNELS] = {};
+
+	for (const textureChannel& channel : m_channels) {
+		textures[channel.index] = m_textures.get(channel.path);
+	}
+
+	// no texture samples black
+	for (unsigned int i = 0; i < MAX_TEXTURE_CHANNELS; i++) {
+		glActiveTexture(GL_TEXTURE0 + CHANNEL_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void App::renderScaled() {
+	int w, h;
+
+	getSurfaceSize(w, h);
+
+	// pooled at the window size : changing the scale never reallocates
+	if (m_scaledTarget.width != (GLuint)w || m_scaledTarget.height != (GLuint)h) {
+		if (!createRenderTarget(m_scaledTarget, w, h)) {
+			std::cerr << "Error: cannot create the dynamic resolution target, disabling it." << std::endl;
+			m_dynamicResolution = false;
+			m_renderScale = 1.0f;
+			render();
+			return;
+		}
+	}
+
+	const GLint scaledWidth = std::max(1, (int)std::lround(w * m_renderScale));
+	const GLint scaledHeight = std::max(1, (int)std::lround(h * m_renderScale));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_scaledTarget.fbo);
+	glViewport(0, 0, scaledWidth, scaledHeight);
+
+	render();
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_scaledTarget.fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, scaledWidth, scaledHeight, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, w, h);
+}
+
+void App::updateRenderScale() {
+	// GPU timings come back a few frames late : only react to new ones
+	if (m_stats.gpu.total == m_lastScaledSample) {
+		return;
+	}
+
+	m_lastScaledSample = m_stats.gpu.total;
+
+	const double gpuTime = lastSample(m_stats.gpu);
+
+	if (gpuTime <= 0) {
+		return;
+	}
+
+	// the cost grows with the pixel count, i.e. with the square of the scale.
+	// Only a part of the way is done every sample, the timing being late.
+	const float ideal = m_renderScale * (float)std::sqrt(m_targetFrameTime / gpuTime);
+	const float scale = glm::clamp(m_renderScale + (ideal - m_renderScale) * 0.25f, RENDER_SCALE_MIN, 1.0f);
+
+	if (std::abs(scale - m_renderScale) >= 0.01f) {
+		m_renderScale = scale;
+	}
+}
+
+void App::toggleDynamicResolution() {
+	if (!m_dynamicResolution && !m_buffers.empty()) {
+		std::cout << "[Resolution] Not available for shaders with buffers" << std::endl;
+		return;
+	}
+
+	m_dynamicResolution = !m_dynamicResolution;
+	m_renderScale = 1.0f;
+
+	if (m_dynamicResolution && m_accumulationSamples > 0) {
+		toggleAccumulation();
+	}
+
+	if (m_dynamicResolution && m_tiled) {
+		toggleTiled();
+	}
+
+	if (m_dynamicResolution) {
+		std::cout << "[Resolution] Dynamic, target " << m_targetFrameTime << " ms per frame" << std::endl;
+	}
+	else {
+		deleteRenderTarget(m_scaledTarget);
+		std::cout << "[Resolution] Native" << std::endl;
+	}
+}
+
+void App::renderTiled() {
+	int w, h;
+
+	getSurfaceSize(w, h);
+
+	bool restart = false;
+
+	if (m_tiledTarget.width != (GLuint)w || m_tiledTarget.height != (GLuint)h) {
+		if (!createRenderTarget(m_tiledTarget, w, h)) {
+			std::cerr << "Error: cannot create the tiled rendering target, disabling it." << std::endl;
+			m_tiled = false;
+			render();
+			return;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_tiledTarget.fbo);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		restart = true;
+	}
+
+	if (m_tiledQuery == 0) {
+		glGenQueries(1, &m_tiledQuery);
+	}
+
+	// what the shader sees, the time aside : it is frozen during a pass
+	globalsBlock state;
+	fillStillState(state);
+
+	// an animated shader starts a new pass, at the new time, as soon as one is done
+	if (restart
+		|| std::memcmp(&state, &m_tiledState, sizeof(globalsBlock)) != 0
+		|| (m_nextTile >= m_tiles.size() && m_shader.animated))
+	{
+		m_tiledState = state;
+		restartTiles(w, h);
+	}
+
+	// the last batch must be done before issuing another one : the GPU is never flooded,
+	// so the frame is always presented quickly, however heavy a tile is
+	if (m_tiledQueryPending) {
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(m_tiledQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (available == GL_TRUE) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(m_tiledQuery, GL_QUERY_RESULT, &elapsed);
+
+			const double tileTime = std::max(elapsed / 1e6 / m_tiledQueryTiles, 1e-3);
+
+			m_tilesPerFrame = std::clamp((size_t)(m_options.tileBudget / tileTime), (size_t)1, m_tiles.size());
+			m_tiledQueryPending = false;
+		}
+	}
+
+	if (!m_tiledQueryPending && m_nextTile < m_tiles.size()) {
+		const size_t count = std::min(m_tilesPerFrame, m_tiles.size() - m_nextTile);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_tiledTarget.fbo);
+		glViewport(0, 0, w, h);
+		glEnable(GL_SCISSOR_TEST);
+
+		glBeginQuery(GL_TIME_ELAPSED, m_tiledQuery);
+
+		glUseProgram(m_program);
+		glBindVertexArray(m_surface.VAO);
+
+		// once for the whole batch, at the time of the pass
+		m_tiledDrawing = true;
+		sendUniforms();
+		m_tiledDrawing = false;
+
+		bindTextureChannels();
+
+		for (size_t i = 0; i < count; i++) {
+			const glm::ivec4& tile = m_tiles[m_nextTile + i];
+
+			glScissor(tile.x, tile.y, tile.z, tile.w);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+
+		fenceUniformRing(m_globalsRing);
+
+		glBindVertexArray(0);
+		glUseProgram(0);
+
+		glEndQuery(GL_TIME_ELAPSED);
+
+		glDisable(GL_SCISSOR_TEST);
+
+		m_nextTile += count;
+		m_tiledQueryTiles = count;
+		m_tiledQueryPending = true;
+	}
+
+	// present : the tiles not rendered yet still show the previous pass
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_tiledTarget.fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void App::restartTiles(int width, int height) {
+	m_tiles.clear();
+
+	for (int y = 0; y < height; y += TILE_SIZE) {
+		for (int x = 0; x < width; x += TILE_SIZE) {
+			m_tiles.push_back(glm::ivec4(x, y, std::min(TILE_SIZE, width - x), std::min(TILE_SIZE, height - y)));
+		}
+	}
+
+	// the center first, where the eye is
+	const glm::vec2 center(width * 0.5f, height * 0.5f);
+
+	std::stable_sort(m_tiles.begin(), m_tiles.end(), [&center](const glm::ivec4& a, const glm::ivec4& b) {
+		const glm::vec2 da = glm::vec2(a.x + a.z * 0.5f, a.y + a.w * 0.5f) - center;
+		const glm::vec2 db = glm::vec2(b.x + b.z * 0.5f, b.y + b.w * 0.5f) - center;
+
+		return glm::dot(da, da) < glm::dot(db, db);
+	});
+
+	m_nextTile = 0;
+	m_tiledTime = m_time;
+}
+
+/**
+ * Halton low-discrepancy sequence, index >= 1.
+ */
+static float halton(unsigned int index, unsigned int base) {
+	float result = 0.0f;
+	float fraction = 1.0f / base;
+
+	while (index > 0) {
+		result += fraction * (index % base);
+		index /= base;
+		fraction /= base;
+	}
+
+	return result;
+}
+
+void App::renderAccumulated() {
+	int w, h;
+
+	getSurfaceSize(w, h);
+
+	if (m_accumulationTarget.width != (GLuint)w || m_accumulationTarget.height != (GLuint)h) {
+		if (!createRenderTarget(m_accumulationTarget, w, h, GL_RGBA32F)) {
+			std::cerr << "Error: cannot create the accumulation target, disabling it." << std::endl;
+			m_accumulationSamples = 0;
+			render();
+			return;
+		}
+
+		m_accumulated = 0;
+	}
+
+	globalsBlock state;
+	fillStillState(state);
+
+	if (std::memcmp(&state, &m_accumulationState, sizeof(globalsBlock)) != 0) {
+		m_accumulationState = state;
+		m_accumulated = 0;
+	}
+
+	if (m_accumulated < m_accumulationSamples) {
+		// the first sample at the pixel center : the image is the usual one from the start
+		m_jitter = m_accumulated == 0
+			? glm::vec2(0, 0)
+			: glm::vec2(halton(m_accumulated, 2) - 0.5f, halton(m_accumulated, 3) - 0.5f);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_accumulationTarget.fbo);
+		glViewport(0, 0, w, h);
+
+		// running average : the sample n weighs 1 / (n + 1)
+		if (m_accumulated > 0) {
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+			glBlendColor(0.0f, 0.0f, 0.0f, 1.0f / (m_accumulated + 1));
+		}
+
+		render(m_accumulated == 0);
+
+		glDisable(GL_BLEND);
+
+		m_jitter = glm::vec2(0, 0);
+		m_accumulated++;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_accumulationTarget.fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool App::canAccumulate() const {
+	// an animated image never stays still, and buffers are stateful
+	return !m_shader.animated && m_buffers.empty();
+}
+
+void App::restartStillImage() {
+	// the still state cannot be all zeros : the next comparison always differs
+	m_accumulationState = {};
+	m_tiledState = {};
+	m_accumulated = 0;
+}
+
+bool App::isAccumulating() const {
+	return m_accumulationSamples > 0 && canAccumulate() && m_accumulated < m_accumulationSamples;
+}
+
+void App::toggleAccumulation() {
+	if (m_accumulationSamples > 0) {
+		m_accumulationSamples = 0;
+		deleteRenderTarget(m_accumulationTarget);
+		std::cout << "[Accumulation] Disabled" << std::endl;
+		return;
+	}
+
+	m_accumulationSamples = m_options.accumulate > 0 ? m_options.accumulate : DEFAULT_ACCUMULATION_SAMPLES;
+	m_accumulated = 0;
+
+	if (m_dynamicResolution) {
+		toggleDynamicResolution();
+	}
+
+	if (m_tiled) {
+		toggleTiled();
+	}
+
+	std::cout << "[Accumulation] " << m_accumulationSamples << " samples per pixel while the view is still";
+
+	if (!canAccumulate()) {
+		std::cout << " (not for this shader : it is animated or has buffers)";
+	}
+
+	std::cout << std::endl;
+}
+
+static bool endsWith(const std::string& str, const std::string& suffix) {
+	return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void App::startCapture() {
+	const std::string output = m_options.captureOutput.empty() ? DEFAULT_CAPTURE_DIR : m_options.captureOutput;
+
+	// a .y4m file or stdout is a video, anything else a folder of images
+	imageFormat format = m_options.outputFormat == IMAGE_Y4M ? IMAGE_PNG : m_options.outputFormat;
+
+	if (output == "-" || endsWith(output, ".y4m")) {
+		format = IMAGE_Y4M;
+	}
+
+	// real-time : frames are dropped rather than slowing down the rendering
+	if (m_capture.start(output, format, m_realWidth, m_realHeight, m_options.captureFps, true)) {
+		std::cerr << "[Capture] Recording " << m_realWidth << "x" << m_realHeight << " to " << output << std::endl;
+	}
+}
+
+void App::captureFrame() {
+	// a video cannot change its size, and a sequence of images should not either
+	if (m_capture.getWidth() != m_realWidth || m_capture.getHeight() != m_realHeight) {
+		std::cerr << "[Capture] The window was resized, capture stopped" << std::endl;
+		m_capture.stop();
+		return;
+	}
+
+	m_capture.capture(0);
+}
+
+void App::toggleCapture() {
+	// headless runs capture with --output
+	if (m_options.headless) {
+		return;
+	}
+
+	if (m_capture.isCapturing()) {
+		m_capture.stop();
+	}
+	else {
+		startCapture();
+	}
+}
+
+void App::dumpTrace() {
+	if (!isTraceEnabled()) {
+		setTraceEnabled(true);
+		std::cout << "[Trace] Tracing, F10 again to write the last " << m_options.traceSeconds << " s" << std::endl;
+		return;
+	}
+
+	writeTrace(m_options.tracePath.empty() ? DEFAULT_TRACE_FILE : m_options.tracePath, m_options.traceSeconds);
+}
+
+bool App::isTiling() const {
+	return m_tiled && (m_nextTile < m_tiles.size() || m_tiledQueryPending);
+}
+
+void App::toggleTiled() {
+	if (!m_tiled && !m_buffers.empty()) {
+		std::cout << "[Tiled] Not available for shaders with buffers" << std::endl;
+		return;
+	}
+
+	m_tiled = !m_tiled;
+
+	if (m_tiled) {
+		if (m_dynamicResolution) {
+			toggleDynamicResolution();
+		}
+
+		if (m_accumulationSamples > 0) {
+			toggleAccumulation();
+		}
+
+		std::cout << "[Tiled] Progressive rendering, " << m_options.tileBudget << " ms of tiles per frame" << std::endl;
+	}
+	else {
+		deleteRenderTarget(m_tiledTarget);
+		m_tiles.clear();
+		m_tiledQueryPending = false;
+		std::cout << "[Tiled] Disabled" << std::endl;
+	}
+}
+
+void App::updateFPS() {
+	// Time update
+	m_fps.currentTime = glfwGetTime();
+
+	const double frameTime = m_fps.currentTime - m_fps.lastFrame;
+	m_fps.lastFrame = m_fps.currentTime;
+
+	if (m_options.fixedStep > 0) {
+		// deterministic : frame n is always rendered at n / fixedStep, whatever the real time
+		m_time = (double)m_clockFrame / m_options.fixedStep;
+		m_uniforms.delta.f = (float)(1.0 / m_options.fixedStep);
+		m_clockFrame++;
+	}
+	else {
+		m_time = m_fps.currentTime;
+		m_uniforms.delta.f = (float)frameTime;
+	}
+
+	pushSample(m_stats.cpu, frameTime * 1000.0);
+
+	// nbFrame counter update
+	m_fps.nbFrames++;
+
+	const double elapsed = m_fps.currentTime - m_fps.lastTime;
+
+	if (elapsed >= 1.0) { // If last title update was more than 1 sec ago
+		const statsSummary gpu = summarize(m_stats.gpu);
+
+		// every mode adds its field : a string, whatever their number and width
+		std::ostringstream title;
+
+		title << std::fixed << std::setprecision(2)
+			<< "ShaderPlayground [" << (int)std::round(m_fps.nbFrames / elapsed) << " FPS | GPU "
+			<< gpu.mean << " ms, p95 " << gpu.p95 << " ms";
+
+		if (m_dynamicResolution) {
+			title << " | scale " << m_renderScale << " (" << std::lround(m_realWidth * m_renderScale)
+				<< "x" << std::lround(m_realHeight * m_renderScale) << ")";
+		}
+
+		if (m_tiled) {
+			title << " | tiles " << m_nextTile << "/" << m_tiles.size();
+		}
+
+		if (m_accumulationSamples > 0 && canAccumulate()) {
+			title << " | samples " << m_accumulated << "/" << m_accumulationSamples;
+		}
+
+		if (m_capture.isCapturing()) {
+			title << " | REC";
+		}
+
+		if (isDeepZoom()) {
+			title << " | zoom " << std::scientific << std::setprecision(1) << m_zoom << std::fixed
+				<< ", orbit " << m_orbit.length();
+		}
+
+		if (m_player.isReplaying()) {
+			title << " | replay " << m_player.getCurrentFrame() << "/" << m_player.getFrameCount();
+		}
+
+		title << "]";
+
+		glfwSetWindowTitle(m_window, title.str().c_str());
+
+		// reset counter
+		m_fps.nbFrames = 0;
+
+		// lastTime update
+		m_fps.lastTime = m_fps.currentTime;
+	}
+}
+
+bool App::isIdle() const {
+	return m_options.idle
+		&& !m_shader.animated
+		&& m_buffers.empty()
+		&& !m_redraw
+		&& !m_reloadSwapped
+		&& m_zooming == 0
+		&& m_displacement == glm::vec2(0, 0)
+		&& !isTiling()
+		&& !isAccumulating()
+		&& !m_capture.isCapturing()
+		&& !m_player.isReplaying();
+}
+
+void App::reset() {
+	m_zoom = 1.0;
+	m_centerX = {};
+	m_centerY = {};
+	m_time = 0;
+	m_clockFrame = 0;
+	m_uniforms.increment.i = 0;
+
+	if (!m_options.headless) {
+		glfwSetTime(0);
+	}
+}
+
+sessionState App::getSessionState() const {
+	sessionState state;
+
+	state.shaderName = m_fractalName;
+	state.width = m_realWidth;
+	state.height = m_realHeight;
+	state.centerX = m_centerX;
+	state.centerY = m_centerY;
+	state.zoom = m_zoom;
+	state.increment = m_uniforms.increment.i;
+	state.mode = m_keyTabUniform;
+	state.zooming = m_zooming;
+	state.panX = (int32_t)m_displacement.x;
+	state.panY = (int32_t)m_displacement.y;
+	state.mouseX = m_uniforms.mouse.v2.x;
+	state.mouseY = m_uniforms.mouse.v2.y;
+
+	for (unsigned int i = 0; i < KEY_FLAGS_COUNT; i++) {
+		state.flagsMask |= (m_boolFlagsUniforms[i] == GL_TRUE) << i;
+	}
+
+	for (unsigned int i = 0; i < KEY_SPECIAL_COUNT; i++) {
+		state.keyMask |= (m_keySpecialFlagsUniforms[i] == GL_TRUE) << i;
+	}
+
+	for (unsigned int i = 0; i < MOUSE_BTN_COUNT; i++) {
+		state.mouseMask |= (m_mouseFlagsUniforms[i] != 0) << i;
+	}
+
+	return state;
+}
+
+void App::applySessionState(const sessionState& state) {
+	m_centerX = state.centerX;
+	m_centerY = state.centerY;
+	m_zoom = state.zoom;
+	m_uniforms.increment.i = state.increment;
+	m_keyTabUniform = state.mode;
+	m_zooming = state.zooming;
+	m_displacement = glm::vec2(state.panX, state.panY);
+	m_uniforms.mouse.v2 = glm::vec2((float)state.mouseX, (float)state.mouseY);
+
+	for (unsigned int i = 0; i < KEY_FLAGS_COUNT; i++) {
+		m_boolFlagsUniforms[i] = (state.flagsMask >> i) & 1 ? GL_TRUE : GL_FALSE;
+	}
+
+	for (unsigned int i = 0; i < KEY_SPECIAL_COUNT; i++) {
+		m_keySpecialFlagsUniforms[i] = (state.keyMask >> i) & 1 ? GL_TRUE : GL_FALSE;
+	}
+
+	for (unsigned int i = 0; i < MOUSE_BTN_COUNT; i++) {
+		m_mouseFlagsUniforms[i] = (state.mouseMask >> i) & 1;
+	}
+
+	m_redraw = true;
+}
+
+bool App::startReplay() {
+	if (!m_player.open(m_options.replayPath)) {
+		return false;
+	}
+
+	const sessionState& state = m_player.getState();
+
+	if (state.shaderName != m_fractalName) {
+		std::cerr << "[Replay] The session was recorded with " << state.shaderName
+			<< ", not " << m_fractalName << std::endl;
+	}
+
+	// the mouse positions and the rendered frames are only the same at the same resolution
+	if (m_options.headless) {
+		setOffscreenSize(state.width, state.height);
+	}
+	else if (state.width != m_realWidth || state.height != m_realHeight) {
+		if (m_windowMode == windowMode::FULLSCREEN) {
+			toggleFullscreen();
+		}
+
+		glfwSetWindowSize(m_window, state.width, state.height);
+		glfwPollEvents();
+		refreshResolution();
+		refreshSurface();
+
+		if (state.width != m_realWidth || state.height != m_realHeight) {
+			std::cerr << "[Replay] Recorded at " << state.width << "x" << state.height
+				<< ", replayed at " << m_realWidth << "x" << m_realHeight << std::endl;
+		}
+	}
+
+	applySessionState(state);
+
+	std::cout << "[Replay] " << m_player.getFrameCount() << " frames from " << m_options.replayPath << std::endl;
+
+	m_replayStart = getTimerSeconds();
+
+	return true;
+}
+
+/**
+ * Keys of the application itself (render modes, reload, capture, trace, window, library) :
+ * they do not change what the shader sees, and would make a replay depend on the machine.
+ */
+static bool isControlKey(int key) {
+	return (key >= GLFW_KEY_F4 && key <= GLFW_KEY_F12)
+		|| key == GLFW_KEY_PAGE_UP
+		|| key == GLFW_KEY_PAGE_DOWN
+		|| key == GLFW_KEY_ESCAPE;
+}
+
+bool App::replayFrame() {
+	sessionFrame frame;
+
+	if (!m_player.nextFrame(frame)) {
+		return false;
+	}
+
+	for (const sessionEvent& event : frame.events) {
+		switch (event.type) {
+			case SESSION_KEY:
+				// F9 (reset) is kept : it moves the view and the clock
+				if (!isControlKey(event.key) || event.key == GLFW_KEY_F9) {
+					onKey(event.key, event.scancode, event.action, event.mods);
+				}
+				break;
+			case SESSION_MOUSE_BUTTON:
+				onMouseButton(event.key, event.action, event.mods);
+				break;
+			case SESSION_MOUSE_MOVE:
+				onMouseMove(event.x, event.y);
+				break;
+		}
+	}
 
-	if (m_uniforms.delta.value.f >= 1.0) { // If last cout was more than 1 sec ago
-		const double fps = 1.0 / m_uniforms.delta.value.f;
+	m_time = frame.time;
+	m_uniforms.delta.f = frame.delta;
 
-		std::stringstream ss;
-		ss << "ShaderPlayground" << " [" << (m_fps.nbFrames-1) << " FPS]";
+	return true;
+}
 
-		glfwSetWindowTitle(m_window, ss.str().c_str());
+void App::finishReplay() {
+	const double seconds = getTimerSeconds() - m_replayStart;
+	const size_t frames = m_player.getFrameCount();
+	const statsSummary gpu = summarize(m_stats.gpu);
 
-		// reset counter
-		m_fps.nbFrames = 0;
+	std::cout << "[Replay] " << frames << " frames of " << m_fractalName << " in "
+		<< std::fixed << std::setprecision(3) << seconds << " s, "
+		<< std::setprecision(1) << frames / seconds << " frames/s, GPU "
+		<< std::setprecision(2) << gpu.mean << " ms, p95 " << gpu.p95 << " ms" << std::defaultfloat << std::endl;
 
-		// lastTime update
-		m_fps.lastTime  = m_fps.currentTime;
-	}
-}
+	m_player.stop();
 
-void App::reset() {
-	m_uniforms.zoom.value.f = 1.0f;
-	m_uniforms.center.value.v2 = glm::vec2(0.0f, 0.0f);
-	m_uniforms.increment.value.i = 0;
-	glfwSetTime(0);
+	// like Esc : back to the prompt
+	m_needEscape = true;
 }
 
 void App::refreshResolution() {
 	int w, h;
 
-	glfwGetWindowSize(m_window, &w, &h);
+	getSurfaceSize(w, h);
 
 	m_realWidth = w;
 	m_realHeight = h;
@@ -209,32 +1773,123 @@ void App::refreshResolution() {
 
 	m_frustrum.ratio = (float)w / (float)h;
 
-	m_uniforms.m.value.m4 = glm::mat4(1);
-	m_uniforms.v.value.m4 = glm::lookAt(eye, target, up);
-	m_uniforms.p.value.m4 = glm::perspective(glm::radians(m_frustrum.fov), m_frustrum.ratio, m_frustrum.near, m_frustrum.far);
+	m_uniforms.m.m4 = glm::mat4(1);
+	m_uniforms.v.m4 = glm::lookAt(eye, target, up);
+	m_uniforms.p.m4 = glm::perspective(glm::radians(m_frustrum.fov), m_frustrum.ratio, m_frustrum.near, m_frustrum.far);
+
+	m_uniforms.mvp.m4 = m_uniforms.p.m4 * m_uniforms.v.m4 * m_uniforms.m.m4;
+	m_uniforms.resolution.v2 = glm::vec2(w, h);
+	m_uniforms.ratio.f = m_frustrum.ratio;
+}
+
+static GLint packFlags(const GLint* flags, unsigned int count) {
+	GLint mask = 0;
 
-	m_uniforms.mvp.value.m4 = m_uniforms.p.value.m4 * m_uniforms.v.value.m4 * m_uniforms.m.value.m4;
-	m_uniforms.resolution.value.v2 = glm::vec2(w, h);
-	m_uniforms.ratio.value.f = m_frustrum.ratio;
+	for (unsigned int i = 0; i < count; i++) {
+		if (flags[i] == GL_TRUE) {
+			mask |= 1 << i;
+		}
+	}
+
+	return mask;
+}
+
+// hi + lo, each rounded to float, keeps about 48 bits of the value
+static void splitDouble(double value, GLfloat& hi, GLfloat& lo) {
+	hi = (GLfloat)value;
+	lo = (GLfloat)(value - (double)hi);
+}
+
+static void setGlobalsTime(globalsBlock& block, double time) {
+	splitDouble(time, block.time, block.timeLo);
+	block.timeWrapped = (GLfloat)std::fmod(time, TIME_WRAP_PERIOD);
+}
+
+void App::fillGlobals(globalsBlock& block) const {
+	block.mvp			= m_uniforms.mvp.m4;
+	block.m				= m_uniforms.m.m4;
+	block.v				= m_uniforms.v.m4;
+	block.p				= m_uniforms.p.m4;
+	block.mouse			= m_uniforms.mouse.v2;
+	block.center.x		= (GLfloat)m_centerX.hi;
+	block.center.y		= (GLfloat)m_centerY.hi;
+	block.centerLo.x	= (GLfloat)ddToDouble(ddSub(m_centerX, doubleDouble{ block.center.x, 0 }));
+	block.centerLo.y	= (GLfloat)ddToDouble(ddSub(m_centerY, doubleDouble{ block.center.y, 0 }));
+	block.resolution	= m_uniforms.resolution.v2;
+	block.delta			= m_uniforms.delta.f;
+	block.ratio			= m_uniforms.ratio.f;
+	block.increment		= m_uniforms.increment.i;
+	block.mode			= m_keyTabUniform;
+	block.mouseMask		= packFlags(m_mouseFlagsUniforms, MOUSE_BTN_COUNT);
+	block.keyMask		= packFlags(m_keySpecialFlagsUniforms, KEY_SPECIAL_COUNT);
+	block.flagsMask		= packFlags(m_boolFlagsUniforms, KEY_FLAGS_COUNT);
+
+	// dynamic resolution : fragCoord, uvResolution and ivMouse in pixels of the internal resolution
+	const float scale = m_dynamicResolution && !m_player.isReplaying() ? m_renderScale : 1.0f;
+
+	block.renderScale	= scale;
+	block.resolution	= glm::vec2(
+		std::max(1L, std::lround(m_uniforms.resolution.v2.x * scale)),
+		std::max(1L, std::lround(m_uniforms.resolution.v2.y * scale))
+	);
+	block.mouse			= m_uniforms.mouse.v2 * scale;
+
+	block.frame			= m_frame;
+	block.jitter		= m_jitter;
+
+	splitDouble(m_zoom, block.zoom, block.zoomLo);
+	setGlobalsTime(block, m_time);
+
+	// perturbation : the shader only needs the offset to the reference, small enough for a float
+	const bool deep = isDeepZoom();
+
+	block.deepZoom		= deep ? 1 : 0;
+	block.deepOffset	= deep
+		? glm::vec2(ddToDouble(ddSub(m_centerX, m_orbit.cx)), ddToDouble(ddSub(m_centerY, m_orbit.cy)))
+		: glm::vec2(0, 0);
+	block.padding		= 0;
+}
+
+void App::fillStillState(globalsBlock& state) const {
+	fillGlobals(state);
+
+	setGlobalsTime(state, 0);
+	state.delta = 0;
+	state.frame = 0;
+	state.jitter = glm::vec2(0, 0);
+
+	if (!m_shader.readsMouse) {
+		state.mouse = glm::vec2(0, 0);
+		state.mouseMask = 0;
+	}
 }
 
 void App::sendUniforms() {
-	glUniformMatrix4fv(m_uniforms.mvp.id, 1, GL_FALSE, glm::value_ptr(m_uniforms.mvp.value.m4));
-	glUniformMatrix4fv(m_uniforms.m.id, 1, GL_FALSE, glm::value_ptr(m_uniforms.m.value.m4));
-	glUniformMatrix4fv(m_uniforms.v.id, 1, GL_FALSE, glm::value_ptr(m_uniforms.v.value.m4));
-	glUniformMatrix4fv(m_uniforms.p.id, 1, GL_FALSE, glm::value_ptr(m_uniforms.p.value.m4));
-	glUniform2fv(m_uniforms.center.id, 1, glm::value_ptr(m_uniforms.center.value.v2));
-	glUniform2fv(m_uniforms.mouse.id, 1, glm::value_ptr(m_uniforms.mouse.value.v2));
-	glUniform2fv(m_uniforms.resolution.id, 1, glm::value_ptr(m_uniforms.resolution.value.v2));
-	glUniform1f(m_uniforms.time.id, m_uniforms.time.value.f);
-	glUniform1f(m_uniforms.delta.id, m_uniforms.delta.value.f);
-	glUniform1f(m_uniforms.ratio.id, m_uniforms.ratio.value.f);
-	glUniform1f(m_uniforms.zoom.id, m_uniforms.zoom.value.f);
-	glUniform1i(m_uniforms.increment.id, m_uniforms.increment.value.i);
-	glUniform1i(m_keyTabFragLoc, m_keyTabUniform);
-	glUniform1iv(m_mouseFragLoc, MOUSE_BTN_COUNT, (GLint*)m_mouseFlagsUniforms);
-	glUniform1iv(m_keysFragLoc, KEY_SPECIAL_COUNT, (GLint*)m_keySpecialFlagsUniforms);
-	glUniform1iv(m_flagsFragLoc, KEY_FLAGS_COUNT, (GLint*)m_boolFlagsUniforms);
+	TRACE_SCOPE("uniforms");
+
+	globalsBlock block;
+
+	fillGlobals(block);
+
+	// only the tiles : the other paths (headless, fallbacks) render at the current time
+	if (m_tiledDrawing) {
+		setGlobalsTime(block, m_tiledTime);
+	}
+
+	// only the changed parts are copied : the matrices rarely are
+	const size_t matricesSize = offsetof(globalsBlock, mouse);
+
+	if (std::memcmp(&block, &m_globals, matricesSize) != 0) {
+		markUniformRing(m_globalsRing, 0, matricesSize);
+	}
+
+	if (std::memcmp((const char*)&block + matricesSize, (const char*)&m_globals + matricesSize, sizeof(globalsBlock) - matricesSize) != 0) {
+		markUniformRing(m_globalsRing, matricesSize, sizeof(globalsBlock) - matricesSize);
+	}
+
+	m_globals = block;
+
+	uploadUniformRing(m_globalsRing, &m_globals, GLOBALS_BINDING);
 
 	/*std::cout << "flags: "
 		<< m_boolFlagsUniforms[0]
@@ -281,34 +1936,70 @@ void App::createWindow() {
 	// keyboard & mouse pos input callback
 	glfwSetKeyCallback(m_window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
 		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
-		app->onKey(key, scancode, action, mods);
+		app->receiveKey(key, scancode, action, mods);
 	});
 
 	glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double xpos, double ypos) {
 		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
-		app->onMouseMove(xpos, ypos);
+		app->receiveMouseMove(xpos, ypos);
 	});
 
 	glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int button, int action, int mods) {
 		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
-		app->onMouseButton(button, action, mods);
+		app->receiveMouseButton(button, action, mods);
 	});
 
 	glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int width, int height) {
 		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
 		app->onWindowResize(width, height);
 	});
+
+	// the content was damaged (uncovered, restored...) : draw it again, even in idle mode
+	glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window) {
+		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+		app->m_redraw = true;
+	});
+}
+
+
+void App::receiveKey(int key, int scancode, int action, int mods) {
+	// the session is the only input of a replay, Esc still stops it
+	if (m_player.isReplaying() && key != GLFW_KEY_ESCAPE) {
+		return;
+	}
+
+	m_recorder.key(key, scancode, action, mods);
+	onKey(key, scancode, action, mods);
+}
+
+void App::receiveMouseButton(int button, int action, int mods) {
+	if (m_player.isReplaying()) {
+		return;
+	}
+
+	m_recorder.mouseButton(button, action, mods);
+	onMouseButton(button, action, mods);
 }
 
+void App::receiveMouseMove(double xpos, double ypos) {
+	if (m_player.isReplaying()) {
+		return;
+	}
+
+	m_recorder.mouseMove(xpos, ypos);
+	onMouseMove(xpos, ypos);
+}
 
 void App::onKey(int key, int scancode, int action, int mods) {
+	m_redraw = true;
+
 	if (action == GLFW_REPEAT) {
 		switch (key) {
 			case GLFW_KEY_I:
-				m_uniforms.increment.value.i++;
+				m_uniforms.increment.i++;
 				break;
 			case GLFW_KEY_D:
-				m_uniforms.increment.value.i--;
+				m_uniforms.increment.i--;
 				break;
 		}
 	}
@@ -354,27 +2045,48 @@ void App::onKey(int key, int scancode, int action, int mods) {
 				m_displacement.y = 1;
 				break;
 			case GLFW_KEY_I:
-				m_uniforms.increment.value.i++;
+				m_uniforms.increment.i++;
 				break;
 			case GLFW_KEY_D:
-				m_uniforms.increment.value.i--;
+				m_uniforms.increment.i--;
 				break;
 		}
 	}
 	else if (action == GLFW_RELEASE) {
 		switch (key) {
+			case GLFW_KEY_F4:
+				toggleAccumulation();
+				break;
 			case GLFW_KEY_F5:
 				refreshShader();
 				break;
+			case GLFW_KEY_F6:
+				toggleDynamicResolution();
+				break;
+			case GLFW_KEY_F7:
+				toggleTiled();
+				break;
 			case GLFW_KEY_F8:
 				toggleVSync();
 				break;
 			case GLFW_KEY_F9:
 				reset();
 				break;
+			case GLFW_KEY_F10:
+				dumpTrace();
+				break;
 			case GLFW_KEY_F11:
 				toggleFullscreen();
 				break;
+			case GLFW_KEY_F12:
+				toggleCapture();
+				break;
+			case GLFW_KEY_PAGE_UP:
+				switchShader(-1);
+				break;
+			case GLFW_KEY_PAGE_DOWN:
+				switchShader(1);
+				break;
 			case GLFW_KEY_0:
 			case GLFW_KEY_1:
 			case GLFW_KEY_2:
@@ -421,6 +2133,8 @@ void App::onKey(int key, int scancode, int action, int mods) {
 }
 
 void App::onMouseButton(int button, int action, int mods) {
+	m_redraw = true;
+
 	switch (button) {
 		case GLFW_MOUSE_BUTTON_LEFT:
 			m_mouseFlagsUniforms[0] = action == GLFW_PRESS;
@@ -436,16 +2150,27 @@ void App::onMouseButton(int button, int action, int mods) {
 
 
 void App::onMouseMove(double xpos, double ypos) {
-	m_uniforms.mouse.value.v2.x = (float)xpos;
-	m_uniforms.mouse.value.v2.y = (float)ypos;
+	// idle mode : nothing to draw again if the shader does not care
+	if (m_shader.readsMouse) {
+		m_redraw = true;
+	}
+
+	m_uniforms.mouse.v2.x = (float)xpos;
+	m_uniforms.mouse.v2.y = (float)ypos;
 }
 
 void App::onWindowResize(int width, int height) {
+	m_redraw = true;
+
 	refreshResolution();
 	refreshSurface();
 }
 
 void App::toggleFullscreen() {
+	if (m_window == nullptr) {
+		return;
+	}
+
 	const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
 
 	// windowed -> fullscreen
@@ -465,6 +2190,10 @@ void App::toggleFullscreen() {
 }
 
 void App::toggleVSync() {
+	if (m_window == nullptr) {
+		return;
+	}
+
 	m_vsync = !m_vsync;
 
 	if (m_vsync) {
@@ -515,52 +2244,462 @@ void App::initGLEW() {
 }
 
 
+void App::initHeadless() {
+	if (!createHeadlessContext(m_headlessContext) || !makeHeadlessContextCurrent(&m_headlessContext)) {
+		std::cerr << "Failed to create the headless OpenGL context" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW built for GLX complains about the missing X display with an EGL context,
+	// but the GL entry points are loaded at this point.
+	if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+		err = GLEW_OK;
+	}
+#endif
+
+	if (GLEW_OK != err)
+	{
+		std::cerr << "Glew Init Error: " << glewGetErrorString(err) << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	std::cout << "Headless renderer : " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+
+	glEnable(GL_DEPTH_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	if (!createRenderTarget(m_offscreen, m_windowWidth, m_windowHeight)) {
+		std::cerr << "Failed to create the offscreen framebuffer" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_offscreen.fbo);
+
+	refreshResolution();
+}
+
 bool App::initShader() {
+	clearVariants();
 	deleteShader(m_shader); // destroy previous shader if exists
 
-	if (!loadShader(m_shader, m_fractalName)) {
+	// a reload still in flight belongs to the previous program
+	m_reloadRequest = 0;
+
+	if (!loadLibraryShader(m_shader, m_fractalName) || !loadBufferPasses()) {
+		deleteShader(m_shader);
+		m_program = 0;
 		return false;
 	}
 
-	m_uniforms.mvp				= { -1, 0 };
-	m_uniforms.m				= { -1, 0 };
-	m_uniforms.v				= { -1, 0 };
-	m_uniforms.p				= { -1, 0 };
-	m_uniforms.mouse			= { -1, 0 };
-	m_uniforms.center			= { -1, 0 };
-	m_uniforms.resolution		= { -1, 0 };
-	m_uniforms.time				= { -1, 0 };
-	m_uniforms.delta			= { -1, 0 };
-	m_uniforms.ratio			= { -1, 0 };
-	m_uniforms.zoom				= { -1, 0 };
-
-	m_uniforms.center.value.v2	= glm::vec2(0.0f, 0.0f);
-
-	// retrieve layout (location = ?) for UNIFORMS
-	m_uniforms.mvp.id			= glGetUniformLocation(m_shader.id, "MVP");
-	m_uniforms.m.id				= glGetUniformLocation(m_shader.id, "M");
-	m_uniforms.v.id				= glGetUniformLocation(m_shader.id, "V");
-	m_uniforms.p.id				= glGetUniformLocation(m_shader.id, "P");
-	m_uniforms.mouse.id			= glGetUniformLocation(m_shader.id, "ivMouse");
-	m_uniforms.center.id		= glGetUniformLocation(m_shader.id, "fvCenter");
-	m_uniforms.resolution.id	= glGetUniformLocation(m_shader.id, "uvResolution");
-	m_uniforms.time.id			= glGetUniformLocation(m_shader.id, "fTime");
-	m_uniforms.delta.id			= glGetUniformLocation(m_shader.id, "fDelta");
-	m_uniforms.ratio.id			= glGetUniformLocation(m_shader.id, "fRatio");
-	m_uniforms.zoom.id			= glGetUniformLocation(m_shader.id, "fZoom");
-	m_uniforms.increment.id		= glGetUniformLocation(m_shader.id, "iIncrement");
-	m_mouseFragLoc				= glGetUniformLocation(m_shader.id, "vbMousePressed");
-	m_keysFragLoc				= glGetUniformLocation(m_shader.id, "vbKeyPressed");
-	m_flagsFragLoc				= glGetUniformLocation(m_shader.id, "vbFlags");
-	m_keyTabFragLoc				= glGetUniformLocation(m_shader.id, "iMode");
+	m_program = m_shader.id;
+
+	// a bad declaration only costs the specialization
+	if (!parseSpecialization(m_fractalName, m_specialized)) {
+		m_specialized.clear();
+	}
+
+	m_frame = 0;
+
+	// another program
+	restartStillImage();
+
+	m_uniforms.mvp				= {};
+	m_uniforms.m				= {};
+	m_uniforms.v				= {};
+	m_uniforms.p				= {};
+	m_uniforms.mouse			= {};
+	m_uniforms.resolution		= {};
+	m_time						= 0;
+	m_uniforms.delta			= {};
+	m_uniforms.ratio			= {};
+
+	// the matrices and the resolution have been cleared above
+	refreshResolution();
+
+	loadTextureChannels();
+	watchShaderFiles();
 
 	return true;
 }
 
+void App::initShaderCompiler() {
+	// created from the main thread (GLFW requirement), made current on the worker
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_compilerWindow = glfwCreateWindow(1, 1, "ShaderPlayground compiler", NULL, m_window);
+
+	if (m_compilerWindow == nullptr) {
+		std::cerr << "Warning: cannot create the shader compiler context, reloads will block the rendering." << std::endl;
+		return;
+	}
+
+	GLFWwindow* window = m_compilerWindow;
+
+	// wakes up the idle loop when a reload is ready
+	m_compiler.setNotifier([]() {
+		glfwPostEmptyEvent();
+	});
+
+	m_compiler.start(
+		[window]() {
+			glfwMakeContextCurrent(window);
+			return glfwGetCurrentContext() == window;
+		},
+		[]() {
+			glfwMakeContextCurrent(nullptr);
+		}
+	);
+}
+
+void App::shelveShaders() {
+	// deleted programs have an invalid id
+	if (glIsProgram(m_shader.id) == GL_TRUE) {
+		m_library.put(m_fractalName, m_shader);
+	}
+
+	m_shader = {};
+
+	for (bufferPass& pass : m_buffers) {
+		if (glIsProgram(pass.program.id) == GL_TRUE) {
+			m_library.put(pass.shaderName, pass.program);
+		}
+
+		pass.program = {};
+	}
+}
+
+bool App::loadLibraryShader(shader& program, const std::string& name) {
+	uint64_t sourceKey = 0;
+
+	// the sources are preprocessed to check the library entry is not stale : far cheaper than a compilation
+	if (shaderSourceKey(name, sourceKey) && m_library.take(name, sourceKey, program)) {
+		return true;
+	}
+
+	return loadShader(program, name);
+}
+
+void App::precompileLibrary() {
+	if (m_libraryNames.empty()) {
+		m_libraryNames = listShaders(SHADER_FOLDER);
+	}
+
+	if (m_libraryNames.empty()) {
+		return;
+	}
+
+	if (m_compiler.isRunning()) {
+		m_libraryRequest = m_compiler.request(m_libraryNames);
+		m_libraryPending = m_libraryNames.size();
+		return;
+	}
+
+	// no worker : compiled right away, still in parallel if the driver can
+	enableParallelShaderCompile();
+
+	const double start = getTimerSeconds();
+
+	std::vector<pendingShader> pending(m_libraryNames.size());
+	std::vector<bool> started(m_libraryNames.size());
+
+	for (size_t i = 0; i < m_libraryNames.size(); i++) {
+		started[i] = beginLoadShader(pending[i], m_libraryNames[i]);
+	}
+
+	for (size_t i = 0; i < m_libraryNames.size(); i++) {
+		shader program;
+
+		if (started[i] && finishLoadShader(pending[i], program)) {
+			m_library.put(m_libraryNames[i], program);
+		}
+	}
+
+	std::cout << "[Library] " << m_library.size() << " shaders ready in "
+		<< std::fixed << std::setprecision(1) << (getTimerSeconds() - start) * 1000.0 << " ms" << std::defaultfloat << std::endl;
+}
+
+void App::switchShader(int direction) {
+	if (m_libraryNames.empty()) {
+		m_libraryNames = listShaders(SHADER_FOLDER);
+	}
+
+	if (m_libraryNames.empty()) {
+		return;
+	}
+
+	const int count = (int)m_libraryNames.size();
+	const auto current = std::find(m_libraryNames.begin(), m_libraryNames.end(), m_fractalName);
+
+	const int index = current == m_libraryNames.end()
+		? 0
+		: ((int)(current - m_libraryNames.begin()) + direction + count) % count;
+
+	const std::string previous = m_fractalName;
+	const std::string& name = m_libraryNames[index];
+	const shaderLibraryStats before = m_library.getStats();
+	const double start = getTimerSeconds();
+
+	if (!loadFractal(name)) {
+		std::cerr << "[Library] Failed to load " << name << ", back to " << previous << std::endl;
+		loadFractal(previous);
+		return;
+	}
+
+	const bool hit = m_library.getStats().hits > before.hits;
+
+	std::cout << "[Library] " << name << " in " << std::fixed << std::setprecision(2)
+		<< (getTimerSeconds() - start) * 1000.0 << " ms" << std::defaultfloat
+		<< (hit ? "" : " (compiled)") << std::endl;
+
+	m_redraw = true;
+}
+
+void App::updateVariant() {
+	m_program = m_shader.id;
+
+	if (m_specialized.empty()) {
+		return;
+	}
+
+	globalsBlock block;
+	fillGlobals(block);
+
+	shaderSpecialization specialization;
+
+	for (const std::string& uniform : m_specialized) {
+		specialization.emplace_back(uniform, getSpecializationValue(block, uniform));
+	}
+
+	const std::string key = specializationKey(specialization);
+
+	shaderVariant& variant = m_variants[key];
+	variant.lastUse = ++m_variantClock;
+
+	if (glIsProgram(variant.program.id) == GL_TRUE) {
+		m_program = variant.program.id;
+		return;
+	}
+
+	// requested already, or not worth trying again
+	if (variant.request != 0 || variant.failed) {
+		return;
+	}
+
+	if (m_compiler.isRunning()) {
+		// one at a time : while I / D are held, the values change faster than variants compile
+		if (m_variantRequest == 0) {
+			variant.request = m_compiler.request(m_fractalName, specialization);
+			m_variantRequest = variant.request;
+		}
+	}
+	// no worker (headless) : compiled right away, every following frame benefits from it
+	else if (loadShader(variant.program, m_fractalName, specialization)) {
+		m_program = variant.program.id;
+	}
+	else {
+		variant.failed = true;
+	}
+
+	while (m_variants.size() > SHADER_VARIANT_MAX) {
+		auto oldest = std::min_element(m_variants.begin(), m_variants.end(), [](const auto& a, const auto& b) {
+			return a.second.lastUse < b.second.lastUse;
+		});
+
+		deleteShader(oldest->second.program);
+		m_variants.erase(oldest);
+	}
+}
+
+void App::clearVariants() {
+	for (auto& [key, variant] : m_variants) {
+		deleteShader(variant.program);
+	}
+
+	m_variants.clear();
+
+	// a result still in flight is dropped when it comes back
+	m_variantRequest = 0;
+	m_program = m_shader.id;
+}
+
+void App::pollShaderCompiler() {
+	TRACE_SCOPE("poll compiler");
+
+	compileResult result;
+
+	while (m_compiler.poll(result)) {
+		// --library
+		if (result.id == m_libraryRequest) {
+			if (result.success) {
+				m_library.put(result.name, result.program);
+			}
+
+			if (--m_libraryPending == 0) {
+				std::cout << "[Library] " << m_library.size() << " shaders ready in "
+					<< std::fixed << std::setprecision(1) << result.milliseconds << " ms" << std::defaultfloat << std::endl;
+				m_libraryRequest = 0;
+			}
+
+			continue;
+		}
+
+		// a variant of the current shader
+		if (!result.specialization.empty()) {
+			if (result.id == m_variantRequest) {
+				m_variantRequest = 0;
+			}
+
+			auto variant = m_variants.find(specializationKey(result.specialization));
+
+			// evicted, or the shader changed meanwhile
+			if (result.name != m_fractalName || variant == m_variants.end() || variant->second.request != result.id) {
+				deleteShader(result.program);
+				continue;
+			}
+
+			variant->second.request = 0;
+
+			if (!result.success) {
+				std::cerr << "[Specialize] Failed to compile " << m_fractalName << " (" << variant->first << "), keeping the generic program." << std::endl;
+				variant->second.failed = true;
+				continue;
+			}
+
+			variant->second.program = result.program;
+
+			std::cout << "[Specialize] " << m_fractalName << " (" << variant->first << ") ready in "
+				<< std::fixed << std::setprecision(1) << result.milliseconds << " ms" << std::defaultfloat << std::endl;
+
+			// picked by the next update(), even when idle
+			m_redraw = true;
+			continue;
+		}
+
+		// a buffer pass
+		auto pass = std::find_if(m_buffers.begin(), m_buffers.end(), [&result](const bufferPass& pass) {
+			return pass.reloadRequest == result.id;
+		});
+
+		if (pass != m_buffers.end()) {
+			pass->reloadRequest = 0;
+
+			if (!result.success) {
+				std::cerr << "Error: failed to reload buffer " << (char)('A' + pass->index) << ", keeping the previous one." << std::endl;
+				continue;
+			}
+
+			deleteShader(pass->program);
+			pass->program = result.program;
+			restartStillImage();
+			m_redraw = true;
+			continue;
+		}
+
+		// superseded by a newer reload, or by another fractal loaded meanwhile
+		if (result.id != m_reloadRequest || result.name != m_fractalName) {
+			deleteShader(result.program);
+			continue;
+		}
+
+		// an include may have been added or removed, even if the compilation failed
+		watchShaderFiles();
+
+		if (!result.success) {
+			std::cerr << "Error: failed to reload shader, keeping the previous one." << std::endl;
+			continue;
+		}
+
+		// the uniforms live in the Globals block, nothing to query on the new program
+		clearVariants();
+		deleteShader(m_shader);
+		m_shader = result.program;
+		m_program = m_shader.id;
+		m_frame = 0;
+		restartStillImage();
+
+		if (!parseSpecialization(m_fractalName, m_specialized)) {
+			m_specialized.clear();
+		}
+
+		reloadBufferLayout();
+		loadTextureChannels();
+
+		m_reloadCompileTime = result.milliseconds;
+		m_reloadSwapped = true;
+		m_redraw = true;
+	}
+}
+
+void App::watchShaderFiles() {
+	if (!m_options.watch || m_options.headless) {
+		return;
+	}
+
+	std::vector<std::string> files = getShaderDependencies("res/shaders/" + m_fractalName + ".frag");
+
+	for (const bufferPass& pass : m_buffers) {
+		const std::vector<std::string> dependencies = getShaderDependencies("res/shaders/" + pass.shaderName + ".frag");
+		files.insert(files.end(), dependencies.begin(), dependencies.end());
+	}
+
+	// an edited image reloads the shader, which loads it again
+	for (const textureChannel& channel : m_channels) {
+		files.push_back(std::string(TEXTURE_FOLDER) + "/" + channel.path);
+	}
+
+	m_watcher.watch(files);
+}
+
+void App::reloadBufferLayout() {
+	std::vector<bufferPass> declared;
+
+	if (!parseBufferPasses(m_fractalName, declared) || sameBufferPasses(declared, m_buffers)) {
+		return;
+	}
+
+	// buffers added, removed or changed : rare enough to be loaded synchronously
+	if (!loadBufferPasses()) {
+		std::cerr << "Error: failed to load the buffers of the reloaded shader." << std::endl;
+	}
+
+	watchShaderFiles();
+}
+
+void App::getSurfaceSize(int& width, int& height) const {
+	if (m_options.headless) {
+		width = (int)m_windowWidth;
+		height = (int)m_windowHeight;
+	}
+	else {
+		glfwGetWindowSize(m_window, &width, &height);
+	}
+}
+
+const frameStats& App::getFrameStats() const {
+	return m_stats;
+}
+
+void App::flushFrameStats() {
+	// everything is finished, so every pending timing is available
+	glFinish();
+	collectFrameStats(m_stats);
+}
+
+void App::clearFrameStats() {
+	// drop the timings still in flight, they belong to the previous frames
+	m_stats.timer.resolved = m_stats.timer.issued;
+
+	clearSamples(m_stats.gpu);
+	clearSamples(m_stats.cpu);
+}
+
 std::vector<GLfloat> App::getVerticesScreenSized() const {
 	int w, h;
 
-	glfwGetWindowSize(m_window, &w, &h);
+	getSurfaceSize(w, h);
 
 	const float top = 0;
 	const float left = 0;
@@ -596,7 +2735,34 @@ void App::refreshSurface() {
 }
 
 void App::refreshShader() {
-	if (!replaceFragmentShader(m_shader, m_fractalName)) {
+	if (m_compiler.isRunning()) {
+		// the current programs keep rendering until the new ones are ready
+		for (bufferPass& pass : m_buffers) {
+			pass.reloadRequest = m_compiler.request(pass.shaderName);
+		}
+
+		m_reloadRequest = m_compiler.request(m_fractalName);
+		m_reloadStart = getTimerSeconds();
+		return;
+	}
+
+	bool success = replaceFragmentShader(m_shader, m_fractalName);
+
+	for (bufferPass& pass : m_buffers) {
+		success = replaceFragmentShader(pass.program, pass.shaderName) && success;
+	}
+
+	if (success) {
+		m_frame = 0;
+		restartStillImage();
+		reloadBufferLayout();
+		loadTextureChannels();
+	}
+
+	watchShaderFiles();
+	m_redraw = true;
+
+	if (!success) {
 		std::cerr << "Error: failed to reload shader." << std::endl;
 	}
 }
\ No newline at end of file
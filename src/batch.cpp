@@ -0,0 +1,334 @@
+/**
+ * @author NoxFly
+ */
+
+#include "batch.hpp"
+#include "App.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using batchClock = std::chrono::steady_clock;
+
+struct batchResult {
+	bool ok = false;
+	double loadMs = 0;		// shader, from the library after the first time
+	double renderMs = 0;	// resize, frame and readback
+	double writeMs = 0;
+};
+
+static double elapsedMs(batchClock::time_point from, batchClock::time_point to) {
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+static bool parseJobSize(const std::string& value, unsigned int& width, unsigned int& height) {
+	const size_t x = value.find('x');
+
+	if (x == std::string::npos || x == 0 || !std::isdigit((unsigned char)value[0])) {
+		return false;
+	}
+
+	const int w = std::atoi(value.substr(0, x).c_str());
+	const int h = std::atoi(value.substr(x + 1).c_str());
+
+	if (w <= 0 || h <= 0) {
+		return false;
+	}
+
+	width = (unsigned int)w;
+	height = (unsigned int)h;
+
+	return true;
+}
+
+bool parseBatchJobs(const std::string& path, const options& opts, std::vector<batchJob>& jobs) {
+	std::ifstream file(path);
+
+	if (!file.is_open()) {
+		std::cerr << "[Batch] Cannot open " << path << std::endl;
+		return false;
+	}
+
+	const std::string folder = opts.outputDir.empty() ? DEFAULT_BATCH_DIR : opts.outputDir;
+	std::unordered_map<std::string, unsigned int> names;	// outputs given so far
+
+	std::string line;
+	unsigned int number = 0;
+
+	while (std::getline(file, line)) {
+		number++;
+
+		std::istringstream stream(line.substr(0, line.find('#')));
+		batchJob job;
+
+		if (!(stream >> job.shader)) {
+			continue;
+		}
+
+		job.width = opts.width;
+		job.height = opts.height;
+
+		std::string output;
+		std::string token;
+
+		while (stream >> token) {
+			const size_t equal = token.find('=');
+
+			if (equal == std::string::npos) {
+				if (!parseJobSize(token, job.width, job.height)) {
+					std::cerr << "[Batch] " << path << ":" << number << " : invalid size \"" << token << "\"" << std::endl;
+					return false;
+				}
+
+				continue;
+			}
+
+			const std::string key = token.substr(0, equal);
+			const std::string value = token.substr(equal + 1);
+
+			if (key == "time") {
+				job.time = std::atof(value.c_str());
+			}
+			else if (key == "out") {
+				output = value;
+			}
+			else {
+				// checked by App::setUniform() when the job runs
+				std::vector<std::string> args{ key };
+				std::stringstream values(value);
+				std::string item;
+
+				while (std::getline(values, item, ',')) {
+					args.push_back(item);
+				}
+
+				job.uniforms.push_back(args);
+			}
+		}
+
+		const std::vector<std::string> shaders = job.shader == "*"
+			? listShaders(SHADER_FOLDER)
+			: std::vector<std::string>{ job.shader };
+
+		for (const std::string& shader : shaders) {
+			batchJob expanded = job;
+			expanded.shader = shader;
+
+			std::string name = output;
+
+			if (name.empty() || shaders.size() > 1) {
+				name = shader;
+				std::replace(name.begin(), name.end(), '/', '_');
+				name += "_" + std::to_string(job.width) + "x" + std::to_string(job.height);
+			}
+			else {
+				// given with its extension
+				name = std::filesystem::path(name).replace_extension().generic_string();
+			}
+
+			// the same shader at the same size, with other uniforms
+			const unsigned int count = names[name]++;
+
+			if (count > 0) {
+				name += "_" + std::to_string(count);
+			}
+
+			expanded.output = folder + "/" + name + "." + imageExtension(opts.outputFormat);
+
+			jobs.push_back(expanded);
+		}
+	}
+
+	return true;
+}
+
+static void setEnv(const char* name, const std::string& value) {
+#ifdef _WIN32
+	if (std::getenv(name) == nullptr) {
+		_putenv_s(name, value.c_str());
+	}
+#else
+	setenv(name, value.c_str(), 0);
+#endif
+}
+
+struct batchState {
+	const options* opts;
+	const std::vector<batchJob>* jobs;
+	std::vector<batchResult> results;
+	std::atomic<size_t> next{ 0 };
+	std::atomic<size_t> done{ 0 };
+	std::mutex logMutex;
+	std::mutex contextMutex;	// glewInit() writes globals : one context is set up at a time
+};
+
+static void runWorker(batchState& state) {
+	setTraceThreadName("batch worker");
+
+	const std::vector<batchJob>& jobs = *state.jobs;
+
+	options opts = *state.opts;
+	opts.width = jobs.front().width;
+	opts.height = jobs.front().height;
+
+	std::unique_ptr<App> app;
+
+	{
+		std::lock_guard<std::mutex> lock(state.contextMutex);
+		app = std::make_unique<App>(opts);
+	}
+
+	std::vector<unsigned char> pixels;
+
+	// the jobs are taken one by one : a slow shader does not hold a whole share of them
+	for (size_t i = state.next++; i < jobs.size(); i = state.next++) {
+		TRACE_SCOPE("batch job");
+
+		const batchJob& job = jobs[i];
+		batchResult& result = state.results[i];
+		std::string error;
+
+		const auto t0 = batchClock::now();
+
+		// reloaded for every job, so none depends on the previous one (its programs come from the library)
+		bool ok = app->loadFractal(job.shader);
+
+		if (!ok) {
+			error = "shader not found or invalid";
+		}
+
+		const auto t1 = batchClock::now();
+
+		if (ok && !app->setOffscreenSize(job.width, job.height)) {
+			error = "cannot render at this size";
+			ok = false;
+		}
+
+		if (ok) {
+			app->reset();
+
+			for (const std::vector<std::string>& uniform : job.uniforms) {
+				if (!app->setUniform(uniform, error)) {
+					ok = false;
+					break;
+				}
+			}
+		}
+
+		if (ok) {
+			app->renderOffscreenFrame(job.time, opts.fixedDelta);
+			ok = app->readOffscreenPixels(pixels);
+		}
+
+		const auto t2 = batchClock::now();
+
+		if (ok && !writeImage(job.output, opts.outputFormat, pixels.data(), job.width, job.height)) {
+			error = "cannot write " + job.output;
+			ok = false;
+		}
+
+		const auto t3 = batchClock::now();
+
+		result = { ok, elapsedMs(t0, t1), elapsedMs(t1, t2), elapsedMs(t2, t3) };
+
+		std::lock_guard<std::mutex> lock(state.logMutex);
+
+		const size_t done = ++state.done;
+
+		if (!ok) {
+			std::cerr << "[Batch] " << done << "/" << jobs.size() << " " << job.shader << " : " << error << std::endl;
+			continue;
+		}
+
+		std::cout << "[Batch] " << done << "/" << jobs.size() << " " << job.shader << " " << job.width << "x" << job.height
+			<< std::fixed << std::setprecision(1)
+			<< " : load " << result.loadMs << " ms, render " << result.renderMs << " ms, write " << result.writeMs
+			<< " ms -> " << job.output << std::defaultfloat << std::endl;
+	}
+
+	std::lock_guard<std::mutex> lock(state.contextMutex);
+	app.reset();
+}
+
+bool runBatch(const options& opts) {
+	std::vector<batchJob> jobs;
+
+	if (!parseBatchJobs(opts.batchPath, opts, jobs)) {
+		return false;
+	}
+
+	if (jobs.empty()) {
+		std::cerr << "[Batch] No job in " << opts.batchPath << std::endl;
+		return false;
+	}
+
+	for (const batchJob& job : jobs) {
+		std::error_code ec;
+		std::filesystem::create_directories(std::filesystem::path(job.output).parent_path(), ec);
+	}
+
+	const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	const unsigned int workers = (unsigned int)std::min<size_t>(opts.threads > 0 ? opts.threads : cores, jobs.size());
+
+	// llvmpipe rasterizes every context on as many threads as there are cores : share them instead
+	setEnv("LP_NUM_THREADS", std::to_string(std::max(1u, cores / workers)));
+
+	batchState state;
+	state.opts = &opts;
+	state.jobs = &jobs;
+	state.results.resize(jobs.size());
+
+	std::cout << "[Batch] " << jobs.size() << " jobs on " << workers << " workers" << std::endl;
+
+	const auto start = batchClock::now();
+
+	std::vector<std::thread> threads;
+
+	for (unsigned int i = 0; i < workers; i++) {
+		threads.emplace_back(runWorker, std::ref(state));
+	}
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	const double seconds = elapsedMs(start, batchClock::now()) / 1000.0;
+
+	size_t failed = 0;
+	double pixels = 0;
+	double renderMs = 0;
+
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (!state.results[i].ok) {
+			failed++;
+			continue;
+		}
+
+		pixels += (double)jobs[i].width * jobs[i].height;
+		renderMs += state.results[i].renderMs;
+	}
+
+	// the wall time includes the contexts, the compilations and the writes : what the batch really took
+	std::cout << "[Batch] " << jobs.size() - failed << "/" << jobs.size() << " jobs in "
+		<< std::fixed << std::setprecision(3) << seconds << " s, "
+		<< std::setprecision(1) << pixels / seconds / 1e6 << " Mpixel/s overall, "
+		<< (renderMs > 0 ? pixels / renderMs / 1e3 : 0) << " Mpixel/s per worker while rendering"
+		<< std::defaultfloat << std::endl;
+
+	if (!opts.tracePath.empty()) {
+		writeTrace(opts.tracePath, opts.traceSeconds);
+	}
+
+	return failed == 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @author NoxFly
+ */
+
+#include <bufferPass.hpp>
+#include <preprocessor.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+static bool parseFormat(const std::string& value, GLenum& format) {
+	if (value == "rgba8") {
+		format = GL_RGBA8;
+	}
+	else if (value == "rgba16f") {
+		format = GL_RGBA16F;
+	}
+	else if (value == "rgba32f") {
+		format = GL_RGBA32F;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+bool parseBufferPasses(const std::string& shaderName, std::vector<bufferPass>& passes) {
+	passes.clear();
+
+	bool declared[MAX_BUFFER_PASSES] = {};
+
+	for (const shaderDirective& directive : getShaderDirectives("res/shaders/" + shaderName + ".frag")) {
+		if (directive.name != "buffer") {
+			continue;
+		}
+
+		const std::string location = directive.file + ":" + std::to_string(directive.line);
+		const std::vector<std::string>& args = directive.arguments;
+
+		if (args.size() < 2 || args.size() > 3 || args[0].size() != 1 || args[0][0] < 'A' || args[0][0] >= 'A' + MAX_BUFFER_PASSES) {
+			std::cerr << "[Buffer] Expected #buffer <A-D> <path> [rgba8|rgba16f|rgba32f] (" << location << ")" << std::endl;
+			return false;
+		}
+
+		bufferPass pass;
+		pass.index = args[0][0] - 'A';
+		pass.shaderName = args[1];
+
+		if (declared[pass.index]) {
+			std::cerr << "[Buffer] Buffer " << args[0] << " declared twice (" << location << ")" << std::endl;
+			return false;
+		}
+
+		if (args.size() == 3 && !parseFormat(args[2], pass.format)) {
+			std::cerr << "[Buffer] Unknown format " << args[2] << " (" << location << ")" << std::endl;
+			return false;
+		}
+
+		if (pass.shaderName == shaderName) {
+			std::cerr << "[Buffer] The image shader cannot be a buffer of itself (" << location << ")" << std::endl;
+			return false;
+		}
+
+		declared[pass.index] = true;
+		passes.push_back(pass);
+	}
+
+	// rendered from A to D, whatever the declaration order
+	std::sort(passes.begin(), passes.end(), [](const bufferPass& a, const bufferPass& b) {
+		return a.index < b.index;
+	});
+
+	return true;
+}
+
+bool sameBufferPasses(const std::vector<bufferPass>& a, const std::vector<bufferPass>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].index != b[i].index || a[i].shaderName != b[i].shaderName || a[i].format != b[i].format) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool resizeBufferPass(bufferPass& pass, renderTargetPool& pool, GLuint width, GLuint height) {
+	if (pass.targets[0].width == width && pass.targets[0].height == height) {
+		return true;
+	}
+
+	// the previous content cannot be kept across a resize
+	for (renderTarget& target : pass.targets) {
+		if (!acquireRenderTarget(pool, target, width, height, pass.format)) {
+			return false;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	pass.current = 0;
+
+	return true;
+}
+
+void deleteBufferPasses(std::vector<bufferPass>& passes, renderTargetPool& pool) {
+	for (bufferPass& pass : passes) {
+		deleteShader(pass.program);
+		releaseRenderTarget(pool, pass.targets[0]);
+		releaseRenderTarget(pool, pass.targets[1]);
+	}
+
+	passes.clear();
+}
+
+void bindBufferTextures(const std::vector<bufferPass>& passes) {
+	for (const bufferPass& pass : passes) {
+		glActiveTexture(GL_TEXTURE0 + BUFFER_TEXTURE_UNIT + pass.index);
+		glBindTexture(GL_TEXTURE_2D, pass.targets[pass.current].texture);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void unbindBufferTextures() {
+	for (unsigned int i = 0; i < MAX_BUFFER_PASSES; i++) {
+		glActiveTexture(GL_TEXTURE0 + BUFFER_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,332 @@
+/**
+ * @author NoxFly
+ */
+
+#include "console.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+struct consoleClient {
+	int fd;
+
+	explicit consoleClient(int fd) : fd(fd) {}
+
+	~consoleClient() {
+#ifndef _WIN32
+		::close(fd);
+#endif
+	}
+};
+
+struct consoleState {
+	std::mutex mutex;
+	std::deque<consoleCommand> commands;
+	std::function<void()> notifier;
+	bool running = false;
+	bool terminalStarted = false;
+	bool socket = false;
+	int wakeFds[2] = { -1, -1 };	// written by stop() to interrupt the socket thread
+};
+
+static bool parseCommand(const std::string& line, consoleCommand& command) {
+	std::istringstream stream(line);
+	std::string word;
+
+	if (!(stream >> command.name)) {
+		return false;
+	}
+
+	while (stream >> word) {
+		command.args.push_back(word);
+	}
+
+	return true;
+}
+
+static void pushCommand(consoleState& state, consoleCommand&& command) {
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	if (!state.running) {
+		return;
+	}
+
+	state.commands.push_back(std::move(command));
+
+	if (state.notifier) {
+		state.notifier();
+	}
+}
+
+static void printPrompt() {
+	std::cout << "> " << std::flush;
+}
+
+/**
+ * Blocked in std::getline most of the time, which nothing can interrupt :
+ * the thread is detached and only holds the shared state.
+ */
+static void readTerminal(std::shared_ptr<consoleState> state) {
+	std::string line;
+
+	while (std::getline(std::cin, line)) {
+		consoleCommand command;
+
+		if (parseCommand(line, command)) {
+			pushCommand(*state, std::move(command));
+		}
+		else {
+			printPrompt();
+		}
+	}
+
+	// the input is closed : without a socket, no command can come anymore
+	bool socket;
+
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		socket = state->socket;
+	}
+
+	if (!socket) {
+		consoleCommand quit;
+		quit.name = "quit";
+		pushCommand(*state, std::move(quit));
+	}
+}
+
+Console::Console() :
+	m_state(std::make_shared<consoleState>()),
+	m_socketThread(),
+	m_socketFd(-1),
+	m_socketPath()
+{
+}
+
+Console::~Console() {
+	stop();
+}
+
+bool Console::start(const std::string& socketPath) {
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+
+		m_state->running = true;
+		m_state->socket = false;
+
+		// the same stdin for the whole process
+		if (!m_state->terminalStarted) {
+			m_state->terminalStarted = true;
+			std::thread(readTerminal, m_state).detach();
+		}
+	}
+
+	if (socketPath.empty()) {
+		printPrompt();
+		return true;
+	}
+
+#ifdef _WIN32
+	std::cerr << "[Console] --socket is not supported on Windows" << std::endl;
+	return false;
+#else
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		std::cerr << "[Console] Socket path too long : " << socketPath << std::endl;
+		return false;
+	}
+
+	std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+	m_socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (m_socketFd < 0 || pipe(m_state->wakeFds) != 0) {
+		std::cerr << "[Console] Cannot create the socket : " << std::strerror(errno) << std::endl;
+		closeSocket();
+		return false;
+	}
+
+	// left behind by a previous run that did not exit cleanly
+	unlink(socketPath.c_str());
+
+	if (bind(m_socketFd, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(m_socketFd, 4) != 0) {
+		std::cerr << "[Console] Cannot listen on " << socketPath << " : " << std::strerror(errno) << std::endl;
+		closeSocket();
+		return false;
+	}
+
+	m_socketPath = socketPath;
+
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->socket = true;
+	}
+
+	m_socketThread = std::thread(&Console::listen, this);
+
+	std::cout << "[Console] Listening on " << socketPath << std::endl;
+	printPrompt();
+
+	return true;
+#endif
+}
+
+void Console::stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+
+		m_state->running = false;
+		m_state->notifier = nullptr;
+		m_state->commands.clear();
+	}
+
+	closeSocket();
+}
+
+void Console::closeSocket() {
+#ifndef _WIN32
+	if (m_state->wakeFds[1] >= 0) {
+		const char byte = 0;
+		(void)!write(m_state->wakeFds[1], &byte, 1);
+	}
+
+	if (m_socketThread.joinable()) {
+		m_socketThread.join();
+	}
+
+	if (m_socketFd >= 0) {
+		::close(m_socketFd);
+		m_socketFd = -1;
+	}
+
+	for (int& fd : m_state->wakeFds) {
+		if (fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+	if (!m_socketPath.empty()) {
+		unlink(m_socketPath.c_str());
+		m_socketPath.clear();
+	}
+#endif
+}
+
+void Console::setNotifier(const std::function<void()>& notifier) {
+	std::lock_guard<std::mutex> lock(m_state->mutex);
+	m_state->notifier = notifier;
+}
+
+bool Console::poll(consoleCommand& command) {
+	std::lock_guard<std::mutex> lock(m_state->mutex);
+
+	if (m_state->commands.empty()) {
+		return false;
+	}
+
+	command = std::move(m_state->commands.front());
+	m_state->commands.pop_front();
+
+	return true;
+}
+
+void Console::reply(const consoleCommand& command, const std::string& text, bool error) {
+	if (command.client == nullptr) {
+		if (!text.empty()) {
+			(error ? std::cerr : std::cout) << text << std::endl;
+		}
+
+		printPrompt();
+		return;
+	}
+
+#ifndef _WIN32
+	const std::string line = (error ? "error: " : "ok") + (text.empty() || error ? text : " " + text) + "\n";
+
+	// the client may be gone already
+	(void)send(command.client->fd, line.data(), line.size(), MSG_NOSIGNAL);
+#endif
+}
+
+void Console::listen() {
+#ifndef _WIN32
+	// false once stop() wrote to the wake pipe
+	auto waitFor = [this](int fd) {
+		pollfd fds[2] = {
+			{ fd, POLLIN, 0 },
+			{ m_state->wakeFds[0], POLLIN, 0 }
+		};
+
+		while (::poll(fds, 2, -1) < 0) {
+			if (errno != EINTR) {
+				return false;
+			}
+		}
+
+		return fds[1].revents == 0;
+	};
+
+	while (waitFor(m_socketFd)) {
+		const int fd = accept(m_socketFd, nullptr, nullptr);
+
+		if (fd < 0) {
+			continue;
+		}
+
+		// one client at a time, kept alive by its pending commands until they are answered
+		auto client = std::make_shared<consoleClient>(fd);
+
+		std::string pending;
+		char buffer[1024];
+
+		while (waitFor(fd)) {
+			const ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+
+			if (size <= 0) {
+				break;
+			}
+
+			pending.append(buffer, (size_t)size);
+
+			size_t end;
+
+			while ((end = pending.find('\n')) != std::string::npos) {
+				consoleCommand command;
+
+				if (parseCommand(pending.substr(0, end), command)) {
+					command.client = client;
+					pushCommand(*m_state, std::move(command));
+				}
+
+				pending.erase(0, end + 1);
+			}
+		}
+
+		// a last line without newline
+		consoleCommand command;
+
+		if (parseCommand(pending, command)) {
+			command.client = client;
+			pushCommand(*m_state, std::move(command));
+		}
+	}
+#endif
+}
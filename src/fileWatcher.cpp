@@ -0,0 +1,264 @@
+/**
+ * @author NoxFly
+ */
+
+#include <fileWatcher.hpp>
+#include <utils.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// modification times polling period, when inotify is not available
+#define FILE_WATCHER_SCAN_PERIOD std::chrono::milliseconds(250)
+
+static std::string normalizePath(const fs::path& path) {
+	std::error_code ec;
+	const fs::path absolute = fs::absolute(path, ec);
+
+	return (ec ? path : absolute).lexically_normal().string();
+}
+
+/**
+ * Hash of the content of a file, 0 if it cannot be read (e.g. in the middle of a save).
+ */
+static uint64_t hashFile(const std::string& path) {
+	std::ifstream stream(path, std::ios::binary);
+
+	if (!stream.is_open()) {
+		return 0;
+	}
+
+	std::stringstream buffer;
+	buffer << stream.rdbuf();
+
+	return hash64(buffer.str());
+}
+
+static int64_t getMTime(const std::string& path) {
+	std::error_code ec;
+	const auto mtime = fs::last_write_time(path, ec);
+
+	return ec ? 0 : (int64_t)mtime.time_since_epoch().count();
+}
+
+FileWatcher::FileWatcher() :
+	m_fd(-1),
+	m_debounce(std::chrono::milliseconds(100)),
+	m_lastEvent(),
+	m_lastScan(),
+	m_pending(false)
+{
+#ifdef __linux__
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_fd < 0) {
+		std::cerr << "[FileWatcher] inotify unavailable, falling back to polling." << std::endl;
+	}
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+	clear();
+
+#ifdef __linux__
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+#endif
+}
+
+bool FileWatcher::watch(const std::vector<std::string>& files) {
+	std::unordered_map<std::string, uint64_t> watched;
+	std::unordered_set<std::string> directories;
+
+	for (const std::string& file : files) {
+		const std::string path = normalizePath(file);
+
+		auto known = m_files.find(path);
+		watched[path] = known != m_files.end() ? known->second : hashFile(path);
+		directories.insert(fs::path(path).parent_path().string());
+	}
+
+	m_files = std::move(watched);
+
+	m_mtimes.clear();
+
+	for (const auto& file : m_files) {
+		m_mtimes[file.first] = getMTime(file.first);
+	}
+
+#ifdef __linux__
+	if (m_fd < 0) {
+		return true;
+	}
+
+	// drop the folders no longer needed, keep the others
+	for (auto it = m_directories.begin(); it != m_directories.end();) {
+		if (directories.erase(it->second) == 0) {
+			inotify_rm_watch(m_fd, it->first);
+			it = m_directories.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	bool success = true;
+
+	for (const std::string& directory : directories) {
+		// close-write for in-place saves, moved-to/create for the save-rename pattern
+		const int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+		if (wd < 0) {
+			std::cerr << "[FileWatcher] Cannot watch " << directory << std::endl;
+			success = false;
+			continue;
+		}
+
+		m_directories[wd] = directory;
+	}
+
+	return success;
+#else
+	return true;
+#endif
+}
+
+void FileWatcher::clear() {
+#ifdef __linux__
+	if (m_fd >= 0) {
+		for (const auto& directory : m_directories) {
+			inotify_rm_watch(m_fd, directory.first);
+		}
+	}
+#endif
+
+	m_directories.clear();
+	m_files.clear();
+	m_mtimes.clear();
+	m_pending = false;
+}
+
+void FileWatcher::setDebounce(unsigned int milliseconds) {
+	m_debounce = std::chrono::milliseconds(milliseconds);
+}
+
+bool FileWatcher::poll() {
+	if (m_files.empty()) {
+		return false;
+	}
+
+	if (readEvents()) {
+		m_pending = true;
+		m_lastEvent = clock::now();
+	}
+
+	// wait for the burst to settle before reading anything
+	if (!m_pending || clock::now() - m_lastEvent < m_debounce) {
+		return false;
+	}
+
+	m_pending = false;
+
+	return contentChanged();
+}
+
+/**
+ * Returns true if a watched file got an event since the last call.
+ */
+bool FileWatcher::readEvents() {
+	bool touched = false;
+
+#ifdef __linux__
+	if (m_fd >= 0) {
+		alignas(struct inotify_event) char buffer[4096];
+
+		while (true) {
+			const ssize_t length = read(m_fd, buffer, sizeof(buffer));
+
+			if (length <= 0) {
+				// EAGAIN : nothing more to read
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < length;) {
+				const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+				offset += sizeof(struct inotify_event) + event->len;
+
+				// events were lost : check everything
+				if (event->mask & IN_Q_OVERFLOW) {
+					touched = true;
+					continue;
+				}
+
+				if (event->mask & IN_IGNORED) {
+					m_directories.erase(event->wd);
+					continue;
+				}
+
+				auto directory = m_directories.find(event->wd);
+
+				if (event->len == 0 || directory == m_directories.end()) {
+					continue;
+				}
+
+				const std::string path = normalizePath(fs::path(directory->second) / event->name);
+
+				if (m_files.count(path) > 0) {
+					touched = true;
+				}
+			}
+		}
+
+		return touched;
+	}
+#endif
+
+	const clock::time_point now = clock::now();
+
+	if (now - m_lastScan < FILE_WATCHER_SCAN_PERIOD) {
+		return false;
+	}
+
+	m_lastScan = now;
+
+	for (auto& file : m_mtimes) {
+		const int64_t mtime = getMTime(file.first);
+
+		if (mtime != file.second) {
+			file.second = mtime;
+			touched = true;
+		}
+	}
+
+	return touched;
+}
+
+/**
+ * Re-hashes every watched file, returns true if at least one differs from the last known content.
+ */
+bool FileWatcher::contentChanged() {
+	bool changed = false;
+
+	for (auto& file : m_files) {
+		const uint64_t hash = hashFile(file.first);
+
+		// unreadable for now : its next event will tell when it is back
+		if (hash != 0 && hash != file.second) {
+			file.second = hash;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
@@ -0,0 +1,380 @@
+/**
+ * @author NoxFly
+ */
+
+#include "frameCapture.hpp"
+#include "trace.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+struct FrameCapture::encoder {
+	std::string output;
+	imageFormat format = IMAGE_PNG;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	std::FILE* stream = nullptr;		// Y4M only
+
+	std::mutex mutex;
+	std::condition_variable progress;
+	unsigned int pending = 0;			// handed to the pool, not written yet
+	unsigned long long nextFrame = 0;	// Y4M : next frame to append
+	std::map<unsigned long long, std::vector<unsigned char>> converted;	// Y4M : waiting for their turn
+	captureStats stats;
+
+	void write(unsigned long long frame, std::vector<unsigned char>& pixels);
+	void finish(unsigned int frames, bool success);
+};
+
+void FrameCapture::encoder::write(unsigned long long frame, std::vector<unsigned char>& pixels) {
+	TRACE_SCOPE("encode frame");
+
+	if (format != IMAGE_Y4M) {
+		std::stringstream ss;
+		ss << output << "/frame_" << std::setw(5) << std::setfill('0') << frame << "." << imageExtension(format);
+
+		const bool success = writeImage(ss.str(), format, pixels.data(), width, height);
+
+		if (!success) {
+			std::cerr << "[Capture] Failed to write " << ss.str() << std::endl;
+		}
+
+		finish(1, success);
+		return;
+	}
+
+	// converted in parallel, appended in order by whichever job completes the sequence
+	std::vector<unsigned char> yuv;
+	rgbaToYUV420(pixels.data(), width, height, yuv);
+
+	std::vector<unsigned char>().swap(pixels);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	converted.emplace(frame, std::move(yuv));
+
+	unsigned int appended = 0;
+	bool success = true;
+
+	for (auto it = converted.find(nextFrame); it != converted.end(); it = converted.find(nextFrame)) {
+		success = std::fputs("FRAME\n", stream) >= 0
+			&& std::fwrite(it->second.data(), 1, it->second.size(), stream) == it->second.size()
+			&& success;
+
+		converted.erase(it);
+		nextFrame++;
+		appended++;
+	}
+
+	lock.unlock();
+
+	if (appended > 0) {
+		finish(appended, success);
+	}
+}
+
+void FrameCapture::encoder::finish(unsigned int frames, bool success) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		pending -= frames;
+
+		if (success) {
+			stats.written += frames;
+		}
+		else {
+			stats.failed += frames;
+		}
+	}
+
+	progress.notify_all();
+}
+
+FrameCapture::FrameCapture(ThreadPool& pool) :
+	m_pool(pool),
+	m_encoder(nullptr),
+	m_slots{},
+	m_oldest(0),
+	m_inFlight(0),
+	m_frame(0),
+	m_width(0),
+	m_height(0),
+	m_dropWhenBusy(true)
+{
+}
+
+FrameCapture::~FrameCapture() {
+	stop();
+}
+
+bool FrameCapture::start(const std::string& output, imageFormat format, unsigned int width, unsigned int height, double fps, bool dropWhenBusy) {
+	stop();
+
+	auto state = std::make_shared<encoder>();
+
+	state->output = output;
+	state->format = format;
+	state->width = width;
+	state->height = height;
+
+	if (format == IMAGE_Y4M) {
+		if (output == "-") {
+#ifdef _WIN32
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+			state->stream = stdout;
+		}
+		else {
+			state->stream = std::fopen(output.c_str(), "wb");
+		}
+
+		if (state->stream == nullptr) {
+			std::cerr << "[Capture] Failed to open " << output << std::endl;
+			return false;
+		}
+
+		std::fputs(y4mHeader(width, height, fps).c_str(), state->stream);
+	}
+	else {
+		std::error_code ec;
+		std::filesystem::create_directories(output, ec);
+
+		if (ec) {
+			std::cerr << "[Capture] Failed to create " << output << " : " << ec.message() << std::endl;
+			return false;
+		}
+	}
+
+	const GLsizeiptr size = (GLsizeiptr)width * height * 4;
+
+	for (slot& slot : m_slots) {
+		glGenBuffers(1, &slot.pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_encoder = state;
+	m_oldest = 0;
+	m_inFlight = 0;
+	m_frame = 0;
+	m_width = width;
+	m_height = height;
+	m_dropWhenBusy = dropWhenBusy;
+
+	return true;
+}
+
+void FrameCapture::capture(GLuint framebuffer) {
+	if (!m_encoder) {
+		return;
+	}
+
+	collect(false);
+
+	if (!reserve()) {
+		return;
+	}
+
+	// the ring is full : the oldest buffer has to be read before being reused
+	if (m_inFlight == CAPTURE_RING_SIZE) {
+		collect(true);
+	}
+
+	slot& slot = m_slots[(m_oldest + m_inFlight) % CAPTURE_RING_SIZE];
+
+	GLint readFramebuffer = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+
+	// asynchronous : glReadPixels returns as soon as the copy is queued
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = m_frame++;
+
+	m_inFlight++;
+}
+
+bool FrameCapture::reserve() {
+	std::unique_lock<std::mutex> lock(m_encoder->mutex);
+
+	auto hasRoom = [this]() {
+		return m_encoder->pending + m_inFlight < CAPTURE_MAX_PENDING;
+	};
+
+	if (hasRoom()) {
+		return true;
+	}
+
+	if (m_dropWhenBusy) {
+		m_encoder->stats.dropped++;
+		return false;
+	}
+
+	// pending > 0 here, the jobs will make room
+	m_encoder->progress.wait(lock, hasRoom);
+
+	return true;
+}
+
+void FrameCapture::collect(bool waitOldest) {
+	while (m_inFlight > 0) {
+		slot& slot = m_slots[m_oldest];
+
+		GLenum status = glClientWaitSync(slot.fence, 0, 0);
+
+		if (status == GL_TIMEOUT_EXPIRED) {
+			if (!waitOldest) {
+				break;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_encoder->mutex);
+				m_encoder->stats.late++;
+			}
+
+			do {
+				status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			} while (status == GL_TIMEOUT_EXPIRED);
+		}
+
+		// only the oldest one may be waited for
+		waitOldest = false;
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+
+		encode(slot);
+
+		m_oldest = (m_oldest + 1) % CAPTURE_RING_SIZE;
+		m_inFlight--;
+	}
+}
+
+void FrameCapture::encode(slot& slot) {
+	TRACE_SCOPE("readback");
+
+	const size_t size = (size_t)m_width * m_height * 4;
+
+	std::vector<unsigned char> pixels(size);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+
+	if (mapped != nullptr) {
+		std::memcpy(pixels.data(), mapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::shared_ptr<encoder> state = m_encoder;
+
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->pending++;
+	}
+
+	if (mapped == nullptr) {
+		std::cerr << "[Capture] Failed to map frame " << slot.frame << std::endl;
+
+		// a Y4M stream cannot skip a frame : an empty one keeps the sequence going
+		if (state->format != IMAGE_Y4M) {
+			state->finish(1, false);
+			return;
+		}
+	}
+
+	const unsigned long long frame = slot.frame;
+
+	m_pool.submit([state, frame, pixels = std::move(pixels)]() mutable {
+		state->write(frame, pixels);
+	});
+}
+
+void FrameCapture::stop() {
+	if (!m_encoder) {
+		return;
+	}
+
+	while (m_inFlight > 0) {
+		collect(true);
+	}
+
+	for (slot& slot : m_slots) {
+		if (slot.pbo > 0) {
+			glDeleteBuffers(1, &slot.pbo);
+		}
+
+		slot = {};
+	}
+
+	std::shared_ptr<encoder> state = m_encoder;
+	m_encoder = nullptr;
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+
+	state->progress.wait(lock, [&state]() {
+		return state->pending == 0;
+	});
+
+	if (state->stream != nullptr) {
+		std::fflush(state->stream);
+
+		if (state->stream != stdout) {
+			std::fclose(state->stream);
+		}
+
+		state->stream = nullptr;
+	}
+
+	// stdout may be the video itself
+	std::cerr << "[Capture] " << state->stats.written << " frames written to " << state->output
+		<< " (" << state->stats.dropped << " dropped, " << state->stats.late << " late readbacks";
+
+	if (state->stats.failed > 0) {
+		std::cerr << ", " << state->stats.failed << " failed";
+	}
+
+	std::cerr << ")" << std::endl;
+}
+
+bool FrameCapture::isCapturing() const {
+	return m_encoder != nullptr;
+}
+
+unsigned int FrameCapture::getWidth() const {
+	return m_width;
+}
+
+unsigned int FrameCapture::getHeight() const {
+	return m_height;
+}
+
+captureStats FrameCapture::getStats() const {
+	if (!m_encoder) {
+		return {};
+	}
+
+	std::lock_guard<std::mutex> lock(m_encoder->mutex);
+	return m_encoder->stats;
+}
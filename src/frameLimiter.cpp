@@ -0,0 +1,77 @@
+/**
+ * @author NoxFly
+ */
+
+#include "frameLimiter.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <thread>
+
+FrameLimiter::FrameLimiter() :
+	m_period(0),
+	m_deadline(),
+	m_spin(FRAME_LIMITER_MAX_SPIN),
+	m_started(false)
+{
+}
+
+void FrameLimiter::setTargetFps(double fps) {
+	m_period = fps > 0 ? 1.0 / fps : 0;
+	m_started = false;
+}
+
+double FrameLimiter::getTargetFps() const {
+	return m_period > 0 ? 1.0 / m_period : 0;
+}
+
+bool FrameLimiter::isEnabled() const {
+	return m_period > 0;
+}
+
+void FrameLimiter::reset() {
+	m_started = false;
+}
+
+void FrameLimiter::wait() {
+	if (m_period <= 0) {
+		return;
+	}
+
+	TRACE_SCOPE("frame limiter");
+
+	const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(m_period));
+
+	if (!m_started) {
+		m_deadline = clock::now() + period;
+		m_started = true;
+		return;
+	}
+
+	auto now = clock::now();
+
+	// more than a frame late : start over instead of rushing the next frames to catch up
+	if (now >= m_deadline + period) {
+		m_deadline = now + period;
+		return;
+	}
+
+	const auto spin = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(m_spin));
+
+	if (m_deadline - now > spin) {
+		const auto wakeUp = m_deadline - spin;
+
+		std::this_thread::sleep_until(wakeUp);
+
+		// how late the OS woke us up tells how much to spin next time
+		const double overshoot = std::chrono::duration<double>(clock::now() - wakeUp).count();
+
+		m_spin = std::clamp(std::max(m_spin * 0.95, overshoot * 1.5), FRAME_LIMITER_MIN_SPIN, FRAME_LIMITER_MAX_SPIN);
+	}
+
+	while (clock::now() < m_deadline) {
+		std::this_thread::yield();
+	}
+
+	m_deadline += period;
+}
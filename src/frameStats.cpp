@@ -0,0 +1,208 @@
+/**
+ * @author NoxFly
+ */
+
+#include "frameStats.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+bool createGpuTimer(gpuTimer& timer) {
+	glGenQueries(GPU_TIMER_LATENCY * 2, &timer.queries[0][0]);
+
+	timer.issued = 0;
+	timer.resolved = 0;
+	timer.recording = false;
+
+	return timer.queries[0][0] != 0;
+}
+
+void deleteGpuTimer(gpuTimer& timer) {
+	if (timer.queries[0][0] != 0) {
+		glDeleteQueries(GPU_TIMER_LATENCY * 2, &timer.queries[0][0]);
+	}
+
+	timer = gpuTimer{};
+}
+
+void beginGpuTimer(gpuTimer& timer) {
+	timer.recording = timer.queries[0][0] != 0 && timer.issued - timer.resolved < GPU_TIMER_LATENCY;
+
+	if (timer.recording) {
+		glQueryCounter(timer.queries[timer.issued % GPU_TIMER_LATENCY][0], GL_TIMESTAMP);
+	}
+}
+
+void endGpuTimer(gpuTimer& timer) {
+	if (!timer.recording) {
+		return;
+	}
+
+	glQueryCounter(timer.queries[timer.issued % GPU_TIMER_LATENCY][1], GL_TIMESTAMP);
+
+	timer.issued++;
+	timer.recording = false;
+}
+
+bool readGpuTimer(gpuTimer& timer, double& milliseconds) {
+	if (timer.resolved == timer.issued) {
+		return false;
+	}
+
+	const GLuint* pair = timer.queries[timer.resolved % GPU_TIMER_LATENCY];
+	GLint available = GL_FALSE;
+
+	// the end query is issued last, so the start one is available too
+	glGetQueryObjectiv(pair[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (available != GL_TRUE) {
+		return false;
+	}
+
+	GLuint64 start = 0, end = 0;
+
+	glGetQueryObjectui64v(pair[0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(pair[1], GL_QUERY_RESULT, &end);
+
+	milliseconds = (end - start) / 1e6;
+	timer.resolved++;
+
+	return true;
+}
+
+
+void pushSample(rollingStats& stats, double value, size_t window) {
+	if (stats.samples.size() < window) {
+		stats.samples.push_back(value);
+	}
+	else {
+		stats.samples[stats.next] = value;
+	}
+
+	stats.next = (stats.next + 1) % window;
+	stats.total++;
+}
+
+double lastSample(const rollingStats& stats) {
+	if (stats.samples.empty()) {
+		return 0;
+	}
+
+	return stats.samples[(stats.next + stats.samples.size() - 1) % stats.samples.size()];
+}
+
+void clearSamples(rollingStats& stats) {
+	stats.samples.clear();
+	stats.next = 0;
+	stats.total = 0;
+}
+
+statsSummary summarize(const rollingStats& stats) {
+	statsSummary summary;
+
+	if (stats.samples.empty()) {
+		return summary;
+	}
+
+	std::vector<double> sorted = stats.samples;
+	std::sort(sorted.begin(), sorted.end());
+
+	// nearest-rank percentile
+	auto percentile = [&sorted](double p) {
+		const size_t rank = (size_t)std::ceil(p * sorted.size());
+		return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+	};
+
+	double sum = 0;
+
+	for (double v : sorted) {
+		sum += v;
+	}
+
+	summary.count = sorted.size();
+	summary.mean = sum / sorted.size();
+
+	double variance = 0;
+
+	for (double v : sorted) {
+		variance += (v - summary.mean) * (v - summary.mean);
+	}
+
+	// sample standard deviation
+	summary.stddev = sorted.size() > 1 ? std::sqrt(variance / (sorted.size() - 1)) : 0.0;
+	summary.min = sorted.front();
+	summary.p50 = percentile(0.50);
+	summary.p95 = percentile(0.95);
+	summary.p99 = percentile(0.99);
+	summary.max = sorted.back();
+
+	return summary;
+}
+
+
+void collectFrameStats(frameStats& stats) {
+	double ms;
+
+	while (readGpuTimer(stats.timer, ms)) {
+		pushSample(stats.gpu, ms);
+
+		// measured a few frames late : placed when it is read, not when it ran
+		traceCounter("GPU frame (ms)", ms);
+	}
+}
+
+static void writeSummaryLine(std::ostream& out, const char* label, const statsSummary& s) {
+	out << std::left << std::setw(8) << label << std::right
+		<< std::setw(9) << s.mean
+		<< std::setw(9) << s.p50
+		<< std::setw(9) << s.p95
+		<< std::setw(9) << s.p99
+		<< std::setw(9) << s.max
+		<< std::setw(9) << s.count
+		<< "\n";
+}
+
+void writeFrameStats(std::ostream& out, const frameStats& stats) {
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+
+	out << std::fixed << std::setprecision(3)
+		<< "Frame times (ms, last " << FRAME_STATS_WINDOW << " frames)\n"
+		<< std::left << std::setw(8) << "" << std::right
+		<< std::setw(9) << "mean"
+		<< std::setw(9) << "p50"
+		<< std::setw(9) << "p95"
+		<< std::setw(9) << "p99"
+		<< std::setw(9) << "max"
+		<< std::setw(9) << "frames"
+		<< "\n";
+
+	writeSummaryLine(out, "GPU", summarize(stats.gpu));
+	writeSummaryLine(out, "CPU", summarize(stats.cpu));
+
+	out.flags(flags);
+	out.precision(precision);
+	out.flush();
+}
+
+bool dumpFrameStats(const std::string& path, const frameStats& stats) {
+	if (path == "-") {
+		writeFrameStats(std::cout, stats);
+		return true;
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::app);
+
+	if (!file.is_open()) {
+		std::cerr << "[FrameStats] Failed to open " << path << std::endl;
+		return false;
+	}
+
+	writeFrameStats(file, stats);
+
+	return file.good();
+}
@@ -0,0 +1,191 @@
+/**
+ * @author NoxFly
+ */
+
+#include "headless.hpp"
+
+#include <iostream>
+#include <mutex>
+
+#ifdef __linux__
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// The EGL display is shared by every headless context of the process
+// (workers, shared compile contexts) and terminated with the last one.
+static std::mutex displayMutex;
+static EGLDisplay sharedDisplay = EGL_NO_DISPLAY;
+static unsigned int displayRefCount = 0;
+
+static EGLDisplay acquireDisplay() {
+	std::lock_guard<std::mutex> lock(displayMutex);
+
+	if (sharedDisplay == EGL_NO_DISPLAY) {
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if (getPlatformDisplay != nullptr) {
+			// no window system at all : render node if any, software rasterizer otherwise
+			sharedDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+
+		if (sharedDisplay == EGL_NO_DISPLAY) {
+			sharedDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		EGLint major, minor;
+
+		if (sharedDisplay == EGL_NO_DISPLAY || eglInitialize(sharedDisplay, &major, &minor) != EGL_TRUE) {
+			std::cerr << "[Headless] Failed to initialize an EGL display (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+			sharedDisplay = EGL_NO_DISPLAY;
+			return EGL_NO_DISPLAY;
+		}
+	}
+
+	displayRefCount++;
+
+	return sharedDisplay;
+}
+
+static void releaseDisplay() {
+	std::lock_guard<std::mutex> lock(displayMutex);
+
+	if (displayRefCount > 0 && --displayRefCount == 0) {
+		eglTerminate(sharedDisplay);
+		sharedDisplay = EGL_NO_DISPLAY;
+	}
+}
+
+bool createHeadlessContext(headlessContext& ctx, const headlessContext* shared) {
+	EGLDisplay display = acquireDisplay();
+
+	if (display == EGL_NO_DISPLAY) {
+		return false;
+	}
+
+	// eglBindAPI is per-thread state
+	eglBindAPI(EGL_OPENGL_API);
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	EGLint configCount = 0;
+
+	// we never render to an EGL surface, so having no config is fine (EGL_KHR_no_config_context)
+	if (eglChooseConfig(display, configAttribs, &config, 1, &configCount) != EGL_TRUE || configCount == 0) {
+		config = EGL_NO_CONFIG_KHR;
+	}
+
+	const EGLContext shareContext = shared != nullptr ? (EGLContext)shared->context : EGL_NO_CONTEXT;
+	EGLContext context = EGL_NO_CONTEXT;
+
+	// llvmpipe only exposes 4.5
+	for (const EGLint minor : { 6, 5 }) {
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+
+		context = eglCreateContext(display, config, shareContext, contextAttribs);
+
+		if (context != EGL_NO_CONTEXT) {
+			break;
+		}
+	}
+
+	if (context == EGL_NO_CONTEXT) {
+		std::cerr << "[Headless] Failed to create an OpenGL 4.5+ core context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		releaseDisplay();
+		return false;
+	}
+
+	ctx.display = display;
+	ctx.context = context;
+
+	return true;
+}
+
+bool makeHeadlessContextCurrent(const headlessContext* ctx) {
+	eglBindAPI(EGL_OPENGL_API);
+
+	if (ctx == nullptr) {
+		EGLDisplay display = eglGetCurrentDisplay();
+		return display == EGL_NO_DISPLAY
+			|| eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT) == EGL_TRUE;
+	}
+
+	// surfaceless : everything is rendered into framebuffer objects
+	return eglMakeCurrent((EGLDisplay)ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)ctx->context) == EGL_TRUE;
+}
+
+void destroyHeadlessContext(headlessContext& ctx) {
+	if (ctx.context == nullptr) {
+		return;
+	}
+
+	if (eglGetCurrentContext() == (EGLContext)ctx.context) {
+		eglMakeCurrent((EGLDisplay)ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	}
+
+	eglDestroyContext((EGLDisplay)ctx.display, (EGLContext)ctx.context);
+	releaseDisplay();
+
+	ctx = headlessContext{};
+}
+
+#else
+
+#include <GLFW/glfw3.h>
+
+// Fallback : a hidden 1x1 GLFW window. GLFW must only be used from the main thread.
+
+bool createHeadlessContext(headlessContext& ctx, const headlessContext* shared) {
+	if (!glfwInit()) {
+		std::cerr << "[Headless] glfwInit failed" << std::endl;
+		return false;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* sharedWindow = shared != nullptr ? (GLFWwindow*)shared->context : nullptr;
+	GLFWwindow* window = glfwCreateWindow(1, 1, "ShaderPlayground", nullptr, sharedWindow);
+
+	if (window == nullptr) {
+		std::cerr << "[Headless] Failed to create a hidden window" << std::endl;
+		return false;
+	}
+
+	ctx.display = nullptr;
+	ctx.context = window;
+
+	return true;
+}
+
+bool makeHeadlessContextCurrent(const headlessContext* ctx) {
+	glfwMakeContextCurrent(ctx != nullptr ? (GLFWwindow*)ctx->context : nullptr);
+	return true;
+}
+
+void destroyHeadlessContext(headlessContext& ctx) {
+	if (ctx.context != nullptr) {
+		glfwDestroyWindow((GLFWwindow*)ctx.context);
+	}
+
+	ctx = headlessContext{};
+}
+
+#endif
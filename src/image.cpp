@@ -0,0 +1,866 @@
+/**
+ * @author NoxFly
+ */
+
+#include <image.hpp>
+
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    struct crcTable {
+        uint32_t values[256];
+
+        crcTable() {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                values[n] = c;
+            }
+        }
+    };
+
+    // function-local static : built once, thread-safe
+    static const crcTable table;
+
+    crc = ~crc;
+
+    for (size_t i = 0; i < size; i++) {
+        crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+static void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back((value >> 24) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back(value & 0xFF);
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> chunk;
+
+    chunk.reserve(data.size() + 12);
+
+    putU32(chunk, (uint32_t)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putU32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+
+    file.write((const char*)chunk.data(), chunk.size());
+}
+
+bool writePNG(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height, bool flipY) {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "[Image::writePNG] Failed to open " << path << std::endl;
+        return false;
+    }
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write((const char*)signature, 8);
+
+    std::vector<unsigned char> header;
+    putU32(header, width);
+    putU32(header, height);
+    header.push_back(8); // bit depth
+    header.push_back(6); // RGBA
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    writeChunk(file, "IHDR", header);
+
+    // Scanlines, each prefixed by the filter type (0 = none).
+    const size_t stride = (size_t)width * 4;
+    std::vector<unsigned char> scanlines;
+
+    scanlines.reserve((stride + 1) * height);
+
+    for (unsigned int y = 0; y < height; y++) {
+        const unsigned char* row = pixels + stride * (flipY ? height - 1 - y : y);
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), row, row + stride);
+    }
+
+    // zlib stream made of "stored" deflate blocks : no compression,
+    // so encoding cost is a copy, which is what we want when dumping frames.
+    std::vector<unsigned char> zlib;
+    const size_t maxBlock = 65535;
+
+    zlib.reserve(scanlines.size() + scanlines.size() / maxBlock * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    uint32_t a = 1, b = 0;
+
+    for (unsigned char c : scanlines) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    size_t offset = 0;
+
+    do {
+        const size_t blockSize = std::min(maxBlock, scanlines.size() - offset);
+        const bool last = offset + blockSize == scanlines.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(blockSize & 0xFF);
+        zlib.push_back((blockSize >> 8) & 0xFF);
+        zlib.push_back(~blockSize & 0xFF);
+        zlib.push_back((~blockSize >> 8) & 0xFF);
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+
+        offset += blockSize;
+    } while (offset < scanlines.size());
+
+    putU32(zlib, (b << 16) | a);
+
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+
+    return file.good();
+}
+
+/**
+ * Bits of a deflate stream, least significant first.
+ */
+struct bitReader {
+    const unsigned char* data;
+    size_t size;
+    size_t position = 0;
+    uint64_t bits = 0;
+    int count = 0;
+
+    void fill() {
+        while (count <= 56 && position < size) {
+            bits |= (uint64_t)data[position++] << count;
+            count += 8;
+        }
+    }
+
+    bool read(int n, uint32_t& value) {
+        if (count < n) {
+            fill();
+
+            if (count < n) {
+                return false;
+            }
+        }
+
+        value = (uint32_t)(bits & ((1ull << n) - 1));
+        bits >>= n;
+        count -= n;
+
+        return true;
+    }
+};
+
+// codes up to this length are decoded with a single table lookup
+#define HUFFMAN_FAST_BITS 9
+
+/**
+ * Canonical Huffman code of a deflate block.
+ */
+struct huffmanTable {
+    uint16_t counts[16];                        // codes of each length
+    uint16_t symbols[288];                      // sorted by code
+    uint16_t fast[1 << HUFFMAN_FAST_BITS];      // symbol << 4 | length, 0 for the longer codes
+};
+
+static bool buildHuffman(huffmanTable& table, const unsigned char* lengths, int n) {
+    std::fill(std::begin(table.counts), std::end(table.counts), 0);
+    std::fill(std::begin(table.fast), std::end(table.fast), 0);
+
+    for (int i = 0; i < n; i++) {
+        table.counts[lengths[i]]++;
+    }
+
+    table.counts[0] = 0;
+
+    // an incomplete code is allowed (e.g. a single distance), an over-subscribed one is not
+    int left = 1;
+
+    for (int length = 1; length < 16; length++) {
+        left = (left << 1) - table.counts[length];
+
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    uint16_t offsets[16] = {};
+    uint16_t codes[16] = {};
+
+    for (int length = 1; length < 15; length++) {
+        offsets[length + 1] = offsets[length] + table.counts[length];
+        codes[length + 1] = (codes[length] + table.counts[length]) << 1;
+    }
+
+    for (int symbol = 0; symbol < n; symbol++) {
+        const int length = lengths[symbol];
+
+        if (length == 0) {
+            continue;
+        }
+
+        table.symbols[offsets[length]++] = (uint16_t)symbol;
+
+        const unsigned int code = codes[length]++;
+
+        if (length > HUFFMAN_FAST_BITS) {
+            continue;
+        }
+
+        // the stream gives the codes most significant bit first
+        unsigned int reversed = 0;
+
+        for (int i = 0; i < length; i++) {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+
+        for (unsigned int i = reversed; i < (1u << HUFFMAN_FAST_BITS); i += 1u << length) {
+            table.fast[i] = (uint16_t)(symbol << 4 | length);
+        }
+    }
+
+    return true;
+}
+
+static int decodeSymbol(bitReader& in, const huffmanTable& table) {
+    if (in.count < HUFFMAN_FAST_BITS) {
+        in.fill();
+    }
+
+    if (in.count >= HUFFMAN_FAST_BITS) {
+        const uint16_t entry = table.fast[in.bits & ((1u << HUFFMAN_FAST_BITS) - 1)];
+
+        if (entry != 0) {
+            in.bits >>= entry & 15;
+            in.count -= entry & 15;
+            return entry >> 4;
+        }
+    }
+
+    // longer code, or the end of the stream : one bit at a time
+    int code = 0, first = 0, index = 0;
+
+    for (int length = 1; length < 16; length++) {
+        uint32_t bit;
+
+        if (!in.read(1, bit)) {
+            return -1;
+        }
+
+        code |= (int)bit;
+
+        const int count = table.counts[length];
+
+        if (code - count < first) {
+            return table.symbols[index + (code - first)];
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static bool inflateBlock(bitReader& in, const huffmanTable& lengths, const huffmanTable& distances, std::vector<unsigned char>& out) {
+    static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    while (true) {
+        const int symbol = decodeSymbol(in, lengths);
+
+        if (symbol < 0) {
+            return false;
+        }
+
+        if (symbol < 256) {
+            out.push_back((unsigned char)symbol);
+            continue;
+        }
+
+        if (symbol == 256) {
+            return true;
+        }
+
+        const int index = symbol - 257;
+        uint32_t extra;
+
+        if (index >= 29 || !in.read(lengthExtra[index], extra)) {
+            return false;
+        }
+
+        const size_t length = lengthBase[index] + extra;
+        const int code = decodeSymbol(in, distances);
+
+        if (code < 0 || code >= 30 || !in.read(distanceExtra[code], extra)) {
+            return false;
+        }
+
+        const size_t distance = distanceBase[code] + extra;
+
+        if (distance > out.size()) {
+            return false;
+        }
+
+        // byte by byte : a distance shorter than the length repeats the pattern
+        const size_t from = out.size() - distance;
+
+        for (size_t i = 0; i < length; i++) {
+            out.push_back(out[from + i]);
+        }
+    }
+}
+
+static bool inflateDynamic(bitReader& in, std::vector<unsigned char>& out) {
+    static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    uint32_t lengthCount, distanceCount, codeCount;
+
+    if (!in.read(5, lengthCount) || !in.read(5, distanceCount) || !in.read(4, codeCount)) {
+        return false;
+    }
+
+    lengthCount += 257;
+    distanceCount += 1;
+    codeCount += 4;
+
+    if (lengthCount > 286 || distanceCount > 30) {
+        return false;
+    }
+
+    unsigned char lengths[286 + 30] = {};
+
+    for (uint32_t i = 0; i < codeCount; i++) {
+        uint32_t length;
+
+        if (!in.read(3, length)) {
+            return false;
+        }
+
+        lengths[order[i]] = (unsigned char)length;
+    }
+
+    huffmanTable codes, literals, distances;
+
+    if (!buildHuffman(codes, lengths, 19)) {
+        return false;
+    }
+
+    std::fill(std::begin(lengths), std::end(lengths), 0);
+
+    const uint32_t total = lengthCount + distanceCount;
+    uint32_t index = 0;
+
+    while (index < total) {
+        const int symbol = decodeSymbol(in, codes);
+
+        if (symbol < 0) {
+            return false;
+        }
+
+        if (symbol < 16) {
+            lengths[index++] = (unsigned char)symbol;
+            continue;
+        }
+
+        unsigned char value = 0;
+        uint32_t repeat;
+
+        if (symbol == 16) {
+            if (index == 0 || !in.read(2, repeat)) {
+                return false;
+            }
+
+            value = lengths[index - 1];
+            repeat += 3;
+        }
+        else if (symbol == 17) {
+            if (!in.read(3, repeat)) {
+                return false;
+            }
+
+            repeat += 3;
+        }
+        else {
+            if (!in.read(7, repeat)) {
+                return false;
+            }
+
+            repeat += 11;
+        }
+
+        if (index + repeat > total) {
+            return false;
+        }
+
+        std::fill(lengths + index, lengths + index + repeat, value);
+        index += repeat;
+    }
+
+    // a block without an end cannot be decoded
+    if (lengths[256] == 0) {
+        return false;
+    }
+
+    return buildHuffman(literals, lengths, (int)lengthCount)
+        && buildHuffman(distances, lengths + lengthCount, (int)distanceCount)
+        && inflateBlock(in, literals, distances, out);
+}
+
+/**
+ * Decompresses a zlib stream. The Adler-32 is not checked, the chunks of a PNG have their CRC for that.
+ */
+static bool inflateZlib(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+    struct fixedTables {
+        huffmanTable literals;
+        huffmanTable distances;
+
+        fixedTables() {
+            unsigned char lengths[288];
+
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            buildHuffman(literals, lengths, 288);
+
+            std::fill(lengths, lengths + 30, 5);
+            buildHuffman(distances, lengths, 30);
+        }
+    };
+
+    if (data.size() < 6) {
+        return false;
+    }
+
+    const unsigned int cmf = data[0];
+    const unsigned int flg = data[1];
+
+    // deflate, without a preset dictionary
+    if ((cmf & 15) != 8 || (cmf * 256 + flg) % 31 != 0 || (flg & 0x20) != 0) {
+        return false;
+    }
+
+    bitReader in{ data.data() + 2, data.size() - 2 };
+    uint32_t last = 0;
+
+    while (last == 0) {
+        uint32_t type;
+
+        if (!in.read(1, last) || !in.read(2, type)) {
+            return false;
+        }
+
+        if (type == 0) {
+            // stored : byte aligned, what is left in the bit buffer is whole bytes
+            const int skip = in.count % 8;
+
+            in.bits >>= skip;
+            in.count -= skip;
+
+            uint32_t length, complement;
+
+            if (!in.read(16, length) || !in.read(16, complement) || (length ^ 0xFFFF) != complement) {
+                return false;
+            }
+
+            for (; length > 0 && in.count >= 8; length--) {
+                out.push_back((unsigned char)(in.bits & 0xFF));
+                in.bits >>= 8;
+                in.count -= 8;
+            }
+
+            if (in.size - in.position < length) {
+                return false;
+            }
+
+            out.insert(out.end(), in.data + in.position, in.data + in.position + length);
+            in.position += length;
+        }
+        else if (type == 1) {
+            static const fixedTables fixed;
+
+            if (!inflateBlock(in, fixed.literals, fixed.distances, out)) {
+                return false;
+            }
+        }
+        else if (type == 2) {
+            if (!inflateDynamic(in, out)) {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint32_t getU32(const unsigned char* data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+bool readPNG(const std::string& path, std::vector<unsigned char>& pixels, unsigned int& width, unsigned int& height) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open()) {
+        std::cerr << "[Image::readPNG] Failed to open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> data((size_t)file.tellg());
+
+    file.seekg(0);
+    file.read((char*)data.data(), data.size());
+
+    auto fail = [&path](const char* reason) {
+        std::cerr << "[Image::readPNG] " << path << " : " << reason << std::endl;
+        return false;
+    };
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    if (!file || data.size() < 8 || !std::equal(signature, signature + 8, data.begin())) {
+        return fail("not a PNG file");
+    }
+
+    unsigned int depth = 0, colorType = 0;
+    bool header = false;
+    std::vector<unsigned char> compressed, palette, transparency;
+
+    for (size_t offset = 8; offset + 12 <= data.size();) {
+        const uint32_t length = getU32(&data[offset]);
+        const std::string type(data.begin() + offset + 4, data.begin() + offset + 8);
+        const unsigned char* content = &data[offset + 8];
+
+        if (length > data.size() - offset - 12) {
+            return fail("truncated chunk");
+        }
+
+        if (crc32(&data[offset + 4], length + 4) != getU32(content + length)) {
+            return fail("corrupt chunk");
+        }
+
+        if (type == "IHDR" && length >= 13) {
+            width = getU32(content);
+            height = getU32(content + 4);
+            depth = content[8];
+            colorType = content[9];
+
+            if (content[10] != 0 || content[11] != 0) {
+                return fail("unknown compression or filter method");
+            }
+
+            if (content[12] != 0) {
+                return fail("interlaced images are not supported");
+            }
+
+            header = true;
+        }
+        else if (type == "PLTE") {
+            palette.assign(content, content + length);
+        }
+        else if (type == "tRNS") {
+            transparency.assign(content, content + length);
+        }
+        else if (type == "IDAT") {
+            compressed.insert(compressed.end(), content, content + length);
+        }
+        else if (type == "IEND") {
+            break;
+        }
+
+        offset += 12 + (size_t)length;
+    }
+
+    if (!header || width == 0 || height == 0) {
+        return fail("no image header");
+    }
+
+    // 256 Mpixels : a corrupt size, not a texture
+    if ((uint64_t)width * height > (1ull << 28)) {
+        return fail("image too large");
+    }
+
+    unsigned int channels;
+
+    switch (colorType) {
+        case 0: channels = 1; break;    // gray
+        case 2: channels = 3; break;    // RGB
+        case 3: channels = 1; break;    // palette
+        case 4: channels = 2; break;    // gray, alpha
+        case 6: channels = 4; break;    // RGBA
+        default: return fail("unknown color type");
+    }
+
+    const bool subByte = depth == 1 || depth == 2 || depth == 4;
+
+    if (!(depth == 8 || (depth == 16 && colorType != 3) || (subByte && channels == 1))) {
+        return fail("invalid bit depth");
+    }
+
+    if (colorType == 3 && palette.size() < 3) {
+        return fail("no palette");
+    }
+
+    const size_t bitsPerPixel = (size_t)channels * depth;
+    const size_t stride = (width * bitsPerPixel + 7) / 8;
+    const size_t bpp = std::max<size_t>(1, bitsPerPixel / 8);     // distance of the filters, in bytes
+
+    std::vector<unsigned char> scanlines;
+    scanlines.reserve((stride + 1) * height);
+
+    if (!inflateZlib(compressed, scanlines)) {
+        return fail("corrupt image data");
+    }
+
+    if (scanlines.size() < (stride + 1) * height) {
+        return fail("truncated image data");
+    }
+
+    // in place : every row is filtered against the reconstructed previous one
+    for (unsigned int y = 0; y < height; y++) {
+        unsigned char* row = &scanlines[y * (stride + 1) + 1];
+        const unsigned char* prior = y > 0 ? row - (stride + 1) : nullptr;
+
+        switch (row[-1]) {
+            case 0:
+                break;
+            case 1:
+                for (size_t i = bpp; i < stride; i++) {
+                    row[i] += row[i - bpp];
+                }
+                break;
+            case 2:
+                for (size_t i = 0; prior != nullptr && i < stride; i++) {
+                    row[i] += prior[i];
+                }
+                break;
+            case 3:
+                for (size_t i = 0; i < stride; i++) {
+                    const int left = i >= bpp ? row[i - bpp] : 0;
+                    const int up = prior != nullptr ? prior[i] : 0;
+                    row[i] += (unsigned char)((left + up) / 2);
+                }
+                break;
+            case 4:
+                for (size_t i = 0; i < stride; i++) {
+                    const int a = i >= bpp ? row[i - bpp] : 0;
+                    const int b = prior != nullptr ? prior[i] : 0;
+                    const int c = i >= bpp && prior != nullptr ? prior[i - bpp] : 0;
+                    const int pa = std::abs(b - c);
+                    const int pb = std::abs(a - c);
+                    const int pc = std::abs(a + b - 2 * c);
+                    row[i] += (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+                }
+                break;
+            default:
+                return fail("unknown filter");
+        }
+    }
+
+    pixels.resize((size_t)width * height * 4);
+
+    // color key of the gray and RGB images, at their bit depth
+    const bool keyed = (colorType == 0 && transparency.size() >= 2) || (colorType == 2 && transparency.size() >= 6);
+    const unsigned int maxValue = (1u << depth) - 1;
+
+    auto sample = [&](const unsigned char* row, size_t x, unsigned int channel) -> unsigned int {
+        if (depth == 16) {
+            return (unsigned int)row[(x * channels + channel) * 2] << 8 | row[(x * channels + channel) * 2 + 1];
+        }
+
+        if (depth == 8) {
+            return row[x * channels + channel];
+        }
+
+        const size_t bit = x * depth;
+        return (row[bit / 8] >> (8 - depth - bit % 8)) & maxValue;
+    };
+
+    auto toByte = [&](unsigned int value) -> unsigned char {
+        return (unsigned char)(depth == 16 ? value >> 8 : depth == 8 ? value : value * 255 / maxValue);
+    };
+
+    for (unsigned int y = 0; y < height; y++) {
+        const unsigned char* row = &scanlines[y * (stride + 1) + 1];
+        unsigned char* out = &pixels[(size_t)y * width * 4];
+
+        // the usual case is a copy
+        if (colorType == 6 && depth == 8) {
+            std::copy(row, row + stride, out);
+            continue;
+        }
+
+        for (size_t x = 0; x < width; x++, out += 4) {
+            unsigned int r, g, b, a = maxValue;
+
+            switch (colorType) {
+                case 0:
+                    r = g = b = sample(row, x, 0);
+                    if (keyed && r == (unsigned int)(transparency[0] << 8 | transparency[1])) a = 0;
+                    break;
+                case 2:
+                    r = sample(row, x, 0);
+                    g = sample(row, x, 1);
+                    b = sample(row, x, 2);
+                    if (keyed && r == (unsigned int)(transparency[0] << 8 | transparency[1])
+                        && g == (unsigned int)(transparency[2] << 8 | transparency[3])
+                        && b == (unsigned int)(transparency[4] << 8 | transparency[5])) a = 0;
+                    break;
+                case 3: {
+                    // an index out of the palette is black, as most decoders do
+                    const size_t index = sample(row, x, 0);
+                    const bool valid = index * 3 + 2 < palette.size();
+                    out[0] = valid ? palette[index * 3] : 0;
+                    out[1] = valid ? palette[index * 3 + 1] : 0;
+                    out[2] = valid ? palette[index * 3 + 2] : 0;
+                    out[3] = index < transparency.size() ? transparency[index] : 255;
+                    continue;
+                }
+                case 4:
+                    r = g = b = sample(row, x, 0);
+                    a = sample(row, x, 1);
+                    break;
+                default:
+                    r = sample(row, x, 0);
+                    g = sample(row, x, 1);
+                    b = sample(row, x, 2);
+                    a = sample(row, x, 3);
+                    break;
+            }
+
+            out[0] = toByte(r);
+            out[1] = toByte(g);
+            out[2] = toByte(b);
+            out[3] = toByte(a);
+        }
+    }
+
+    return true;
+}
+
+bool writeRaw(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height, bool flipY) {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "[Image::writeRaw] Failed to open " << path << std::endl;
+        return false;
+    }
+
+    const size_t stride = (size_t)width * 4;
+
+    if (!flipY) {
+        file.write((const char*)pixels, stride * height);
+    }
+    else {
+        for (unsigned int y = 0; y < height; y++) {
+            file.write((const char*)pixels + stride * (height - 1 - y), stride);
+        }
+    }
+
+    return file.good();
+}
+
+static unsigned char clampByte(int value) {
+    return (unsigned char)std::min(255, std::max(0, value));
+}
+
+void rgbaToYUV420(const unsigned char* pixels, unsigned int width, unsigned int height, std::vector<unsigned char>& yuv, bool flipY) {
+    const size_t stride = (size_t)width * 4;
+    const unsigned int chromaWidth = (width + 1) / 2;
+    const unsigned int chromaHeight = (height + 1) / 2;
+    const size_t lumaSize = (size_t)width * height;
+    const size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+
+    yuv.resize(lumaSize + chromaSize * 2);
+
+    unsigned char* Y = yuv.data();
+    unsigned char* U = Y + lumaSize;
+    unsigned char* V = U + chromaSize;
+
+    auto row = [&](unsigned int y) {
+        return pixels + stride * (flipY ? height - 1 - y : y);
+    };
+
+    // 8-bit fixed point, offset so the shifts never see a negative value
+    for (unsigned int y = 0; y < height; y++) {
+        const unsigned char* src = row(y);
+
+        for (unsigned int x = 0; x < width; x++, src += 4) {
+            Y[(size_t)y * width + x] = (unsigned char)((77 * src[0] + 150 * src[1] + 29 * src[2] + 128) >> 8);
+        }
+    }
+
+    for (unsigned int cy = 0; cy < chromaHeight; cy++) {
+        const unsigned char* top = row(cy * 2);
+        const unsigned char* bottom = row(std::min(cy * 2 + 1, height - 1));
+
+        for (unsigned int cx = 0; cx < chromaWidth; cx++) {
+            const size_t left = (size_t)cx * 8;
+            const size_t right = std::min(cx * 2 + 1, width - 1) * (size_t)4;
+
+            // average of the 2x2 block
+            const int r = (top[left] + top[right] + bottom[left] + bottom[right] + 2) >> 2;
+            const int g = (top[left + 1] + top[right + 1] + bottom[left + 1] + bottom[right + 1] + 2) >> 2;
+            const int b = (top[left + 2] + top[right + 2] + bottom[left + 2] + bottom[right + 2] + 2) >> 2;
+
+            U[(size_t)cy * chromaWidth + cx] = clampByte((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+            V[(size_t)cy * chromaWidth + cx] = clampByte((128 * r - 107 * g - 21 * b + 32896) >> 8);
+        }
+    }
+}
+
+std::string y4mHeader(unsigned int width, unsigned int height, double fps) {
+    const long rate = std::max(1L, std::lround(fps * 1000.0));
+
+    return "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height)
+        + " F" + std::to_string(rate) + ":1000 Ip A1:1 C420jpeg\n";
+}
+
+bool writeImage(const std::string& path, imageFormat format, const unsigned char* pixels, unsigned int width, unsigned int height, bool flipY) {
+    switch (format) {
+        case IMAGE_RAW:
+            return writeRaw(path, pixels, width, height, flipY);
+        case IMAGE_Y4M:
+            std::cerr << "[Image::writeImage] Y4M is a video stream, not an image format" << std::endl;
+            return false;
+        case IMAGE_PNG:
+        default:
+            return writePNG(path, pixels, width, height, flipY);
+    }
+}
+
+const char* imageExtension(imageFormat format) {
+    switch (format) {
+        case IMAGE_RAW:
+            return "rgba";
+        case IMAGE_Y4M:
+            return "y4m";
+        case IMAGE_PNG:
+        default:
+            return "png";
+    }
+}
@@ -3,27 +3,95 @@
  */
 
 #include "App.hpp"
+#include "batch.hpp"
 #include "utils.hpp"
 
 
+static void printProgramCacheStats() {
+	if (!isProgramCacheEnabled()) {
+		return;
+	}
+
+	const programCacheStats stats = getProgramCacheStats();
+
+	std::cout << "Program cache : " << stats.hits << " hits, " << stats.misses << " misses, "
+		<< stats.stores << " stored, " << stats.evictions << " evicted";
+
+	if (stats.rejected > 0) {
+		std::cout << ", " << stats.rejected << " rejected by the driver";
+	}
+
+	std::cout << std::endl;
+}
+
+
 int main(int argc, char** argv)
 {
-	std::string ipt = "";
+	options opts;
+
+	setTraceThreadName("main");
+
+	if (!parseOptions(argc, argv, opts)) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (opts.help) {
+		printUsage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if (!opts.batchPath.empty()) {
+		const bool success = runBatch(opts);
+		printProgramCacheStats();
+
+		return success ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (opts.headless) {
+		std::string shaderName = opts.shaderName;
 
-	App app;
+		// --replay alone : the shader the session was recorded with
+		if (shaderName.empty()) {
+			SessionPlayer session;
+
+			if (!session.open(opts.replayPath)) {
+				return EXIT_FAILURE;
+			}
+
+			shaderName = session.getState().shaderName;
+		}
+
+		App app(opts);
+
+		if (!app.loadFractal(shaderName)) {
+			std::cerr << "Fractal not found." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		app.runHeadless();
+		printProgramCacheStats();
+
+		return EXIT_SUCCESS;
+	}
+
+	App app(opts);
 
 	std::cout << "====== Welcome to Shader Playground ! ======\n"
 		<< "Author : Noxfly\n\n"
 		<< "Type \"quit\" or \"exit\" to quit.\n"
 		<< "  1. Write fragment shaders (.frag) in res/shaders/ folder.\n"
 		<< "  2. Run this application\n"
-		<< "  3. Enter a .frag file name (without path).\n\n"
+		<< "  3. Enter a .frag file name (without path).\n"
+		<< "The window keeps running while you type : \"load <name>\", \"reload\", \"set <uniform> <value>\", \"screenshot [file]\", \"help\".\n\n"
 		<< "Here some keys :\n"
-		<< "- \"Esc\" when the window is opened to quit.\n"
+		<< "- \"Esc\" when the window is opened to hide it.\n"
 		<< "- \"F5\" to hot-reload the current shader.\n"
 		<< "- \"F8\" to toggle FPS limit.\n"
 		<< "- \"F9\" to reset variables (zoom, camera, ...).\n"
-		<< "- \"F11\" to toggle fullscreen borderless (keep the OS taskbar).\n\n"
+		<< "- \"F10\" to start tracing the frames, then to write the trace.\n"
+		<< "- \"F11\" to toggle fullscreen borderless (keep the OS taskbar).\n"
+		<< "- \"PageUp\" / \"PageDown\" to switch to the previous / next shader.\n\n"
 		<< "For your fragment shaders, it will be included in the main fragment shader code.\n"
 		<< "So, you don't have to write the main function, neither declare the in/out/uniform variables and the #version.\n\n"
 		<< "You can use the #include directive to include other files, as follow : #include <path/nameWithoutExt>.\n"
@@ -31,21 +99,14 @@ int main(int argc, char** argv)
 		<< "\nHave fun !\n\n"
 		<< std::endl;
 
-	while (ipt != "quit" && ipt != "exit") {
-		std::cout << "> ";
-		std::cin >> ipt;
+	if (!opts.shaderName.empty() && !app.loadFractal(opts.shaderName)) {
+		std::cout << "Fractal not found.\n" << std::endl;
+	}
 
-		ipt = trim(ipt);
+	// the console reads the commands on its own threads until "quit"
+	app.run();
 
-		if (ipt != "quit" && ipt != "exit") {
-			if (app.loadFractal(ipt)) {
-				app.run();
-			}
-			else {
-				std::cout << "Fractal not found.\n" << std::endl;
-			}
-		}
-	}
+	printProgramCacheStats();
 
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
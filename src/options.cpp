@@ -0,0 +1,314 @@
+/**
+ * @author NoxFly
+ */
+
+#include <options.hpp>
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+static bool parseSize(const std::string& value, unsigned int& width, unsigned int& height) {
+	const size_t x = value.find('x');
+
+	if (x == std::string::npos) {
+		return false;
+	}
+
+	const int w = std::atoi(value.substr(0, x).c_str());
+	const int h = std::atoi(value.substr(x + 1).c_str());
+
+	if (w <= 0 || h <= 0) {
+		return false;
+	}
+
+	width = (unsigned int)w;
+	height = (unsigned int)h;
+
+	return true;
+}
+
+bool parseOptions(int argc, char** argv, options& opts) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+
+		// options followed by a value
+		auto next = [&](std::string& value) {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for " << arg << std::endl;
+				return false;
+			}
+
+			value = argv[++i];
+			return true;
+		};
+
+		std::string value;
+
+		if (arg == "--help" || arg == "-h") {
+			opts.help = true;
+		}
+		else if (arg == "--headless") {
+			opts.headless = true;
+		}
+		else if (arg == "--shader") {
+			if (!next(opts.shaderName)) return false;
+		}
+		else if (arg == "--size") {
+			if (!next(value)) return false;
+
+			if (!parseSize(value, opts.width, opts.height)) {
+				std::cerr << "Invalid size \"" << value << "\", expected <width>x<height>" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--frames") {
+			if (!next(value)) return false;
+
+			const int frames = std::atoi(value.c_str());
+
+			if (frames <= 0) {
+				std::cerr << "Invalid frame count \"" << value << "\"" << std::endl;
+				return false;
+			}
+
+			opts.frameCount = (unsigned int)frames;
+		}
+		else if (arg == "--dt") {
+			if (!next(value)) return false;
+
+			opts.fixedDelta = std::atof(value.c_str());
+
+			if (opts.fixedDelta <= 0) {
+				std::cerr << "Invalid time step \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--output") {
+			if (!next(opts.outputDir)) return false;
+		}
+		else if (arg == "--format") {
+			if (!next(value)) return false;
+
+			if (value == "png") {
+				opts.outputFormat = IMAGE_PNG;
+			}
+			else if (value == "raw") {
+				opts.outputFormat = IMAGE_RAW;
+			}
+			else if (value == "y4m") {
+				opts.outputFormat = IMAGE_Y4M;
+			}
+			else {
+				std::cerr << "Unknown image format \"" << value << "\", expected png, raw or y4m" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--stats") {
+			if (!next(opts.statsPath)) return false;
+		}
+		else if (arg == "--program-cache") {
+			if (!next(opts.programCacheDir)) return false;
+		}
+		else if (arg == "--program-cache-size") {
+			if (!next(value)) return false;
+
+			opts.programCacheSize = (uint64_t)std::max(0.0, std::atof(value.c_str()) * 1024 * 1024);
+		}
+		else if (arg == "--no-program-cache") {
+			opts.programCacheDir.clear();
+		}
+		else if (arg == "--no-watch") {
+			opts.watch = false;
+		}
+		else if (arg == "--no-idle") {
+			opts.idle = false;
+		}
+		else if (arg == "--tiled") {
+			opts.tiled = true;
+		}
+		else if (arg == "--tile-budget") {
+			if (!next(value)) return false;
+
+			opts.tileBudget = std::atof(value.c_str());
+
+			if (opts.tileBudget <= 0) {
+				std::cerr << "Invalid tile budget \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--accumulate") {
+			if (!next(value)) return false;
+
+			const int samples = std::atoi(value.c_str());
+
+			if (samples <= 0) {
+				std::cerr << "Invalid sample count \"" << value << "\"" << std::endl;
+				return false;
+			}
+
+			opts.accumulate = (unsigned int)samples;
+		}
+		else if (arg == "--capture") {
+			if (!next(opts.captureOutput)) return false;
+		}
+		else if (arg == "--capture-fps") {
+			if (!next(value)) return false;
+
+			opts.captureFps = std::atof(value.c_str());
+
+			if (opts.captureFps <= 0) {
+				std::cerr << "Invalid frame rate \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--fps") {
+			if (!next(value)) return false;
+
+			opts.targetFps = std::atof(value.c_str());
+
+			if (opts.targetFps <= 0) {
+				std::cerr << "Invalid frame rate \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--fixed-step") {
+			if (!next(value)) return false;
+
+			opts.fixedStep = std::atof(value.c_str());
+
+			if (opts.fixedStep <= 0) {
+				std::cerr << "Invalid frame rate \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--record") {
+			if (!next(opts.recordPath)) return false;
+		}
+		else if (arg == "--replay") {
+			if (!next(opts.replayPath)) return false;
+		}
+		else if (arg == "--library") {
+			opts.library = true;
+		}
+		else if (arg == "--batch") {
+			if (!next(opts.batchPath)) return false;
+		}
+		else if (arg == "--threads") {
+			if (!next(value)) return false;
+
+			const int threads = std::atoi(value.c_str());
+
+			if (threads <= 0) {
+				std::cerr << "Invalid thread count \"" << value << "\"" << std::endl;
+				return false;
+			}
+
+			opts.threads = (unsigned int)threads;
+		}
+		else if (arg == "--socket") {
+			if (!next(opts.socketPath)) return false;
+		}
+		else if (arg == "--trace") {
+			if (!next(opts.tracePath)) return false;
+		}
+		else if (arg == "--trace-seconds") {
+			if (!next(value)) return false;
+
+			opts.traceSeconds = std::atof(value.c_str());
+
+			if (opts.traceSeconds <= 0) {
+				std::cerr << "Invalid duration \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--target-ms") {
+			if (!next(value)) return false;
+
+			opts.targetFrameTime = std::atof(value.c_str());
+
+			if (opts.targetFrameTime <= 0) {
+				std::cerr << "Invalid frame time target \"" << value << "\"" << std::endl;
+				return false;
+			}
+		}
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			return false;
+		}
+	}
+
+	// every job renders offscreen, on a worker of its own
+	if (!opts.batchPath.empty()) {
+		if (!opts.recordPath.empty() || !opts.replayPath.empty()) {
+			std::cerr << "--batch cannot record nor replay a session" << std::endl;
+			return false;
+		}
+
+		if (opts.outputFormat == IMAGE_Y4M) {
+			std::cerr << "--batch writes images, y4m is not supported" << std::endl;
+			return false;
+		}
+
+		opts.headless = true;
+	}
+
+	// a session knows its shader
+	if (opts.headless && opts.shaderName.empty() && opts.replayPath.empty() && opts.batchPath.empty()) {
+		std::cerr << "--headless requires --shader <name> or --replay <file>" << std::endl;
+		return false;
+	}
+
+	if (!opts.recordPath.empty() && !opts.replayPath.empty()) {
+		std::cerr << "--record and --replay cannot be used together" << std::endl;
+		return false;
+	}
+
+	if (opts.headless && !opts.recordPath.empty()) {
+		std::cerr << "--record needs the window, there is no input in headless mode" << std::endl;
+		return false;
+	}
+
+	if (opts.headless && !opts.socketPath.empty()) {
+		std::cerr << "--socket only drives the interactive mode" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void printUsage(const char* program) {
+	std::cout << "Usage: " << program << " [options]\n\n"
+		<< "Without options, starts the interactive prompt.\n\n"
+		<< "  --headless                  Render offscreen, without window nor display server.\n"
+		<< "  --shader <name>             Shader to render (path in res/shaders/, without extension). Shown right away without --headless.\n"
+		<< "  --size <w>x<h>              Resolution (default 1280x720).\n"
+		<< "  --frames <n>                Number of frames to render in headless mode (default 60).\n"
+		<< "  --dt <seconds>              Fixed time step between frames in headless mode (default 1/60).\n"
+		<< "  --output <dir|file|->       Write every frame in this folder (a file or stdout for y4m). Nothing is written if omitted.\n"
+		<< "  --format <png|raw|y4m>      Format of the written frames (default png). y4m is a single video stream.\n"
+		<< "  --stats <file|->            Dump GPU/CPU frame time statistics to a file (appended) or stdout on exit.\n"
+		<< "  --program-cache <dir>       Folder of the compiled program cache (default cache/programs).\n"
+		<< "  --program-cache-size <MB>   Size cap of the program cache, least recently used first out (default 64).\n"
+		<< "  --no-program-cache          Always compile the shaders from source.\n"
+		<< "  --no-watch                  Do not reload the shader automatically when its files change.\n"
+		<< "  --no-idle                   Redraw continuously, even when the shader does not read the time.\n"
+		<< "  --tiled                     Progressive tiled rendering, for very expensive shaders (F7 toggles it).\n"
+		<< "  --tile-budget <ms>          GPU time spent on tiles per frame in tiled mode (default 8).\n"
+		<< "  --accumulate <samples>      Antialias still views by accumulating jittered frames (F4 toggles it, default 256).\n"
+		<< "  --capture <dir|file.y4m|->  Record the window from the start (F12 toggles it, default folder captures/).\n"
+		<< "  --capture-fps <fps>         Frame rate of the recorded Y4M video (default 60).\n"
+		<< "  --fps <fps>                 Limit the frame rate, sleeping between frames (F8 only toggles the vsync).\n"
+		<< "  --fixed-step <fps>          Deterministic clock : fTime advances by exactly 1/fps per frame, whatever the real time.\n"
+		<< "  --record <file>             Record the input of each run to a session file, to replay it later.\n"
+		<< "  --replay <file>             Replay a recorded session frame by frame, at its resolution and clock, then stop.\n"
+		<< "  --library                   Compile every shader of res/shaders/ in the background at startup (PageUp/PageDown switch).\n"
+		<< "  --batch <jobs.txt>          Render the stills of a job list on every core, into --output (see README).\n"
+		<< "  --threads <n>               Workers of --batch, each with its own context (default one per core).\n"
+		<< "  --socket <path>             Also read the console commands from this Unix domain socket (one per line).\n"
+		<< "  --trace <file.json>         Trace the frame phases from the start, written when leaving (F10 writes it at any time).\n"
+		<< "  --trace-seconds <s>         Last seconds written to the trace (default 10).\n"
+		<< "  --target-ms <ms>            Enable dynamic resolution, scaled to render a frame in this GPU time (F6 toggles it).\n"
+		<< "  --help                      Show this help.\n"
+		<< std::endl;
+}
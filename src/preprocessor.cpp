@@ -0,0 +1,371 @@
+/**
+ * @author NoxFly
+ */
+
+#include <preprocessor.hpp>
+#include <utils.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+struct fileStamp {
+	fs::file_time_type mtime{};
+	uintmax_t size = 0;
+
+	bool operator==(const fileStamp& other) const {
+		return mtime == other.mtime && size == other.size;
+	}
+};
+
+/**
+ * A parsed file : the text between its include directives.
+ * segments[i] comes before includes[i], and the last segment ends the file.
+ */
+struct sourceFile {
+	int id = 0;
+	fileStamp stamp;
+	std::vector<std::string> segments;
+	std::vector<std::string> includes;
+	std::vector<unsigned int> resumeLines;	// line number following each include directive
+	std::vector<shaderDirective> directives;
+};
+
+struct expansion {
+	std::string code;
+	std::vector<std::pair<std::string, fileStamp>> files;
+	std::vector<shaderDirective> directives;
+};
+
+// directives handled by the playground itself, not by the driver
+static const std::vector<std::string> playgroundDirectives{ "buffer", "channel", "specialize" };
+
+static std::mutex cacheMutex;
+static std::unordered_map<std::string, sourceFile> files;
+static std::unordered_map<std::string, expansion> expansions;
+static std::vector<std::string> sourceNames{ "<prelude>" };	// source string number -> path
+static preprocessorStats stats;
+
+static bool getStamp(const std::string& path, fileStamp& stamp) {
+	std::error_code ec;
+
+	stamp.mtime = fs::last_write_time(path, ec);
+
+	if (ec) {
+		return false;
+	}
+
+	stamp.size = fs::file_size(path, ec);
+
+	return !ec;
+}
+
+static std::string resolveInclude(const std::string& dependencyPath) {
+	return (dependencyPath.front() == '/'
+		? dependencyPath
+		: "res/shaders/" + dependencyPath
+		) + ".glsl";
+}
+
+static bool startsWith(const std::string& str, const std::string& prefix) {
+	return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+/**
+ * Recognizes "#<name> arguments..." for the playground directives.
+ */
+static bool parseDirective(const std::string& line, shaderDirective& directive) {
+	if (line.empty() || line.front() != '#') {
+		return false;
+	}
+
+	std::stringstream ss(line.substr(1));
+	std::string name;
+
+	ss >> name;
+
+	if (std::find(playgroundDirectives.begin(), playgroundDirectives.end(), name) == playgroundDirectives.end()) {
+		return false;
+	}
+
+	directive.name = name;
+	directive.arguments.clear();
+
+	std::string argument;
+
+	while (ss >> argument) {
+		if (argument.size() > 2 && argument.front() == '<' && argument.back() == '>') {
+			argument = argument.substr(1, argument.size() - 2);
+		}
+
+		directive.arguments.push_back(argument);
+	}
+
+	return true;
+}
+
+static bool parseFile(const std::string& path, sourceFile& file) {
+	std::ifstream stream(path);
+
+	if (!stream.is_open()) {
+		return false;
+	}
+
+	file.segments.clear();
+	file.includes.clear();
+	file.resumeLines.clear();
+	file.directives.clear();
+
+	// ENHANCEMENT : for scaling, could be defined by rules and splitted and managed by an external entity
+	const std::string includeIdentifier = "#include";
+	const std::string versionIdentifier = "#version";
+
+	std::string line, segment;
+	unsigned int lineNumber = 0;
+
+	while (std::getline(stream, line)) {
+		lineNumber++;
+
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		const std::string directive = trim(line);
+
+		if (startsWith(directive, includeIdentifier)) {
+			const std::string target = trim(directive.substr(includeIdentifier.size()));
+
+			// not form of '#include <>' with a character between tags
+			if (target.size() < 3 || target.front() != '<' || target.back() != '>') {
+				std::cerr << "[LoadShader] Malformed syntax for include directive (" << path << ":" << lineNumber << ")." << std::endl;
+				return false;
+			}
+
+			file.segments.push_back(segment);
+			file.includes.push_back(resolveInclude(target.substr(1, target.size() - 2)));
+			file.resumeLines.push_back(lineNumber + 1);
+			segment.clear();
+		}
+		else if (startsWith(directive, versionIdentifier)) {
+			// the version is given by the prelude, keep the line numbering
+			segment += '\n';
+		}
+		else if (shaderDirective parsed; parseDirective(directive, parsed)) {
+			parsed.file = path;
+			parsed.line = lineNumber;
+			file.directives.push_back(parsed);
+			segment += '\n';
+		}
+		else {
+			segment += line + '\n';
+		}
+	}
+
+	file.segments.push_back(segment);
+
+	return true;
+}
+
+/**
+ * Returns the parsed file, re-reading it only if it changed on disk.
+ */
+static sourceFile* loadFile(const std::string& path) {
+	fileStamp stamp;
+
+	if (!getStamp(path, stamp)) {
+		return nullptr;
+	}
+
+	auto it = files.find(path);
+
+	if (it != files.end() && it->second.stamp == stamp) {
+		stats.filesReused++;
+		return &it->second;
+	}
+
+	sourceFile parsed;
+
+	if (!parseFile(path, parsed)) {
+		return nullptr;
+	}
+
+	parsed.stamp = stamp;
+	stats.filesRead++;
+
+	if (it != files.end()) {
+		parsed.id = it->second.id;
+		it->second = std::move(parsed);
+		return &it->second;
+	}
+
+	parsed.id = (int)sourceNames.size();
+	sourceNames.push_back(path);
+
+	return &files.emplace(path, std::move(parsed)).first->second;
+}
+
+static bool expand(const std::string& path, std::unordered_set<std::string>& visited, expansion& result) {
+	const sourceFile* file = loadFile(path);
+
+	if (file == nullptr) {
+		std::cerr << "[LoadShader] Failed to import dependency (" << path << ")" << std::endl;
+		return false;
+	}
+
+	result.files.push_back({ path, file->stamp });
+	result.directives.insert(result.directives.end(), file->directives.begin(), file->directives.end());
+	result.code += "#line 1 " + std::to_string(file->id) + "\n";
+
+	for (size_t i = 0; i < file->includes.size(); i++) {
+		result.code += file->segments[i];
+
+		// include-once : already expanded earlier in this shader (or being expanded, for cycles)
+		if (visited.insert(file->includes[i]).second && !expand(file->includes[i], visited, result)) {
+			return false;
+		}
+
+		result.code += "#line " + std::to_string(file->resumeLines[i]) + " " + std::to_string(file->id) + "\n";
+	}
+
+	result.code += file->segments.back();
+
+	return true;
+}
+
+bool preprocessShader(const std::string& filepath, std::string& shaderContent) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	auto cached = expansions.find(filepath);
+
+	if (cached != expansions.end()) {
+		bool upToDate = true;
+
+		for (const auto& dependency : cached->second.files) {
+			fileStamp stamp;
+
+			if (!getStamp(dependency.first, stamp) || !(stamp == dependency.second)) {
+				upToDate = false;
+				break;
+			}
+		}
+
+		if (upToDate) {
+			stats.expansionsReused++;
+			shaderContent += cached->second.code;
+			return true;
+		}
+	}
+
+	if (!fs::is_regular_file(filepath)) {
+		std::cerr << "[LoadShader] Failed to open file. Maybe it does not exist, or wrong access rights." << std::endl;
+		return false;
+	}
+
+	expansion result;
+	std::unordered_set<std::string> visited{ filepath };
+
+	if (!expand(filepath, visited, result)) {
+		return false;
+	}
+
+	shaderContent += result.code;
+	expansions[filepath] = std::move(result);
+
+	return true;
+}
+
+std::vector<std::string> getShaderDependencies(const std::string& filepath) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	std::vector<std::string> dependencies;
+	auto it = expansions.find(filepath);
+
+	if (it != expansions.end()) {
+		for (const auto& dependency : it->second.files) {
+			dependencies.push_back(dependency.first);
+		}
+	}
+
+	return dependencies;
+}
+
+std::vector<shaderDirective> getShaderDirectives(const std::string& filepath) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	auto it = expansions.find(filepath);
+
+	return it != expansions.end() ? it->second.directives : std::vector<shaderDirective>();
+}
+
+static bool parseNumber(const std::string& str, size_t& pos, size_t& value) {
+	const size_t start = pos;
+	value = 0;
+
+	while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9') {
+		value = value * 10 + (str[pos] - '0');
+		pos++;
+	}
+
+	return pos > start;
+}
+
+std::string mapShaderLog(const std::string& log) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	std::stringstream in(log);
+	std::string line, result;
+
+	while (std::getline(in, line)) {
+		size_t pos = 0;
+
+		// AMD / Intel on Windows
+		for (const char* prefix : { "ERROR: ", "WARNING: " }) {
+			if (startsWith(line, prefix)) {
+				pos = std::string(prefix).size();
+			}
+		}
+
+		size_t source, lineNumber;
+		size_t end = pos;
+
+		// Mesa/AMD : "0:12(3): error" or "0:12: error", NVIDIA : "0(12) : error"
+		if (parseNumber(line, end, source) && end < line.size() && (line[end] == ':' || line[end] == '(')) {
+			const bool nvidia = line[end] == '(';
+			end++;
+
+			if (parseNumber(line, end, lineNumber) && source < sourceNames.size()
+				&& (!nvidia || (end < line.size() && line[end] == ')')))
+			{
+				if (nvidia) {
+					end++;
+				}
+
+				line = line.substr(0, pos) + sourceNames[source] + ":" + std::to_string(lineNumber) + line.substr(end);
+			}
+		}
+
+		result += line + '\n';
+	}
+
+	return result;
+}
+
+void clearPreprocessorCache() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	files.clear();
+	expansions.clear();
+	sourceNames.resize(1);
+}
+
+preprocessorStats getPreprocessorStats() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return stats;
+}
@@ -0,0 +1,251 @@
+/**
+ * @author NoxFly
+ */
+
+#include "programCache.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// file layout : header, then the binary
+struct programCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+};
+
+static const char CACHE_MAGIC[4] = { 'S', 'P', 'P', 'B' };
+static const uint32_t CACHE_VERSION = 1;
+
+static std::mutex cacheMutex;
+static bool cacheEnabled = false;
+static fs::path cacheDirectory;
+static uint64_t cacheMaxBytes = 0;
+static std::string driverIdentity;
+static programCacheStats cacheStats;
+
+static fs::path entryPath(uint64_t key) {
+	return cacheDirectory / (toHex(key) + ".bin");
+}
+
+/**
+ * Removes the least recently used entries (oldest modification time,
+ * refreshed on every hit) until the cache fits in its size cap.
+ */
+static void evictEntries() {
+	struct entry {
+		fs::path path;
+		fs::file_time_type lastUse;
+		uintmax_t size;
+	};
+
+	std::vector<entry> entries;
+	uintmax_t total = 0;
+	std::error_code ec;
+
+	for (const auto& file : fs::directory_iterator(cacheDirectory, ec)) {
+		if (!file.is_regular_file(ec) || file.path().extension() != ".bin") {
+			continue;
+		}
+
+		const uintmax_t size = file.file_size(ec);
+		entries.push_back({ file.path(), file.last_write_time(ec), size });
+		total += size;
+	}
+
+	if (total <= cacheMaxBytes) {
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) {
+		return a.lastUse < b.lastUse;
+	});
+
+	for (const entry& e : entries) {
+		if (total <= cacheMaxBytes) {
+			break;
+		}
+
+		if (fs::remove(e.path, ec)) {
+			total -= e.size;
+			cacheStats.evictions++;
+		}
+	}
+}
+
+bool initProgramCache(const std::string& directory, uint64_t maxBytes) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	cacheEnabled = false;
+
+	if (formatCount <= 0 || maxBytes == 0) {
+		return false;
+	}
+
+	std::error_code ec;
+	fs::create_directories(directory, ec);
+
+	if (ec) {
+		std::cerr << "[ProgramCache] Cannot create " << directory << " : " << ec.message() << std::endl;
+		return false;
+	}
+
+	cacheDirectory = directory;
+	cacheMaxBytes = maxBytes;
+	driverIdentity = std::string((const char*)glGetString(GL_VENDOR)) + "\n"
+		+ (const char*)glGetString(GL_RENDERER) + "\n"
+		+ (const char*)glGetString(GL_VERSION) + "\n";
+	cacheEnabled = true;
+
+	return true;
+}
+
+bool isProgramCacheEnabled() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return cacheEnabled;
+}
+
+uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	uint64_t key = hash64(driverIdentity);
+	key = hash64(vertexSource, key);
+	key = hash64("\n--\n", key);
+
+	return hash64(fragmentSource, key);
+}
+
+bool loadCachedProgram(GLuint& program, uint64_t key) {
+	std::vector<char> binary;
+	programCacheHeader header{};
+	fs::path path;
+
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+
+		if (!cacheEnabled) {
+			return false;
+		}
+
+		path = entryPath(key);
+
+		std::ifstream file(path, std::ios::binary);
+
+		if (file.is_open()) {
+			file.read((char*)&header, sizeof(header));
+
+			if (file && std::equal(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic)
+				&& header.version == CACHE_VERSION && header.key == key)
+			{
+				binary.resize(header.length);
+				file.read(binary.data(), binary.size());
+
+				if (!file) {
+					binary.clear();
+				}
+			}
+		}
+
+		if (binary.empty()) {
+			cacheStats.misses++;
+			return false;
+		}
+	}
+
+	program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	std::error_code ec;
+
+	if (success != GL_TRUE) {
+		// driver-side mismatch (format no longer supported, ...) : recompile
+		glDeleteProgram(program);
+		program = 0;
+		fs::remove(path, ec);
+		cacheStats.rejected++;
+		cacheStats.misses++;
+		return false;
+	}
+
+	// the modification time is the LRU timestamp
+	fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+	cacheStats.hits++;
+
+	return true;
+}
+
+void storeCachedProgram(GLuint program, uint64_t key) {
+	if (!isProgramCacheEnabled()) {
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	programCacheHeader header{};
+	std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic);
+	header.version = CACHE_VERSION;
+	header.key = key;
+	header.format = format;
+	header.length = (uint32_t)length;
+
+	// written aside then renamed, so a concurrent reader never sees a partial entry
+	const fs::path path = entryPath(key);
+	fs::path temporary = path;
+	temporary += ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open()) {
+			return;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), length);
+
+		if (!file) {
+			return;
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(temporary, path, ec);
+
+	if (!ec) {
+		cacheStats.stores++;
+		evictEntries();
+	}
+}
+
+programCacheStats getProgramCacheStats() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return cacheStats;
+}
@@ -0,0 +1,151 @@
+/**
+ * @author NoxFly
+ */
+
+#include <referenceOrbit.hpp>
+#include <trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// ReferenceOrbit block (std430) : int iOrbitLength, then vec2 vOrbit[] aligned on 8 bytes
+static const GLintptr ORBIT_HEADER_SIZE = 8;
+
+static const double PI = 3.14159265358979323846;
+
+void extendReferenceOrbit(referenceOrbit& orbit, size_t count) {
+	TRACE_SCOPE("extend orbit");
+
+	const auto start = std::chrono::steady_clock::now();
+
+	orbit.first = orbit.length();
+	orbit.points.clear();
+
+	if (orbit.first == 0) {
+		// Z(0) = 0, so a rebase to the start of the orbit is always possible
+		orbit.zx = {};
+		orbit.zy = {};
+		orbit.points.push_back(glm::vec2(0, 0));
+		count--;
+	}
+
+	count = std::min(count, REFERENCE_ORBIT_MAX_LENGTH - orbit.first - orbit.points.size());
+
+	doubleDouble zx = orbit.zx;
+	doubleDouble zy = orbit.zy;
+
+	for (size_t i = 0; i < count && !orbit.escaped; i++) {
+		const doubleDouble x2 = ddMul(zx, zx);
+		const doubleDouble y2 = ddMul(zy, zy);
+		const doubleDouble xy = ddMul(zx, zy);
+
+		zx = ddAdd(ddSub(x2, y2), orbit.cx);
+		zy = ddAdd(doubleDouble{ xy.hi * 2.0, xy.lo * 2.0 }, orbit.cy);
+
+		orbit.points.push_back(glm::vec2((float)zx.hi, (float)zy.hi));
+
+		// kept, the pixels around may not have escaped yet : they rebase on it
+		orbit.escaped = zx.hi * zx.hi + zy.hi * zy.hi > 4.0;
+	}
+
+	orbit.zx = zx;
+	orbit.zy = zy;
+	orbit.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+referenceOrbit computeReferenceOrbit(doubleDouble x, doubleDouble y, double zoom, ThreadPool& pool) {
+	TRACE_SCOPE("reference orbit");
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<referenceOrbit> candidates(REFERENCE_ORBIT_PROBES);
+
+	// the center, then two rings at half and full 1/zoom
+	for (size_t i = 0; i < candidates.size(); i++) {
+		double dx = 0, dy = 0;
+
+		if (i > 0) {
+			const size_t ring = (i - 1) / 8;
+			const double angle = (i - 1) % 8 * PI / 4.0 + ring * PI / 8.0;
+			const double radius = (ring + 1) * 0.5 / zoom;
+
+			dx = std::cos(angle) * radius;
+			dy = std::sin(angle) * radius;
+		}
+
+		candidates[i].cx = ddAdd(x, dx);
+		candidates[i].cy = ddAdd(y, dy);
+	}
+
+	// a single orbit is sequential, but the candidates are independent
+	pool.parallelFor(candidates.size(), [&candidates](size_t i) {
+		extendReferenceOrbit(candidates[i], REFERENCE_ORBIT_CHUNK);
+	});
+
+	size_t best = 0;
+
+	for (size_t i = 1; i < candidates.size(); i++) {
+		const referenceOrbit& a = candidates[i];
+		const referenceOrbit& b = candidates[best];
+
+		if ((!a.escaped && b.escaped) || (a.escaped && b.escaped && a.length() > b.length())) {
+			best = i;
+		}
+	}
+
+	referenceOrbit orbit = std::move(candidates[best]);
+	orbit.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return orbit;
+}
+
+bool isReferenceOrbitValid(const referenceOrbit& orbit, doubleDouble x, doubleDouble y, double zoom) {
+	if (orbit.length() < 2) {
+		return false;
+	}
+
+	const double dx = ddToDouble(ddSub(x, orbit.cx));
+	const double dy = ddToDouble(ddSub(y, orbit.cy));
+
+	return std::sqrt(dx * dx + dy * dy) * zoom <= REFERENCE_ORBIT_MAX_OFFSET;
+}
+
+bool uploadReferenceOrbit(GLuint& buffer, const referenceOrbit& orbit) {
+	if (buffer == 0) {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, ORBIT_HEADER_SIZE + REFERENCE_ORBIT_MAX_LENGTH * sizeof(glm::vec2), nullptr, GL_DYNAMIC_DRAW);
+
+		if (glGetError() == GL_OUT_OF_MEMORY) {
+			std::cerr << "[ReferenceOrbit] Failed to allocate the orbit buffer" << std::endl;
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			deleteReferenceOrbitBuffer(buffer);
+			return false;
+		}
+	}
+	else {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	}
+
+	const GLint length = (GLint)orbit.length();
+
+	// appended after the points the GPU already has
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, ORBIT_HEADER_SIZE + orbit.first * sizeof(glm::vec2), orbit.points.size() * sizeof(glm::vec2), orbit.points.data());
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(length), &length);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// nothing else uses this binding
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REFERENCE_ORBIT_BINDING, buffer);
+
+	return true;
+}
+
+void deleteReferenceOrbitBuffer(GLuint& buffer) {
+	if (buffer > 0) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
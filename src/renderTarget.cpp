@@ -0,0 +1,97 @@
+/**
+ * @author NoxFly
+ */
+
+#include "renderTarget.hpp"
+
+#include <iostream>
+#include <iterator>
+
+bool createRenderTarget(renderTarget& target, GLuint width, GLuint height, GLenum format) {
+	deleteRenderTarget(target);
+
+	glGenTextures(1, &target.texture);
+	glBindTexture(GL_TEXTURE_2D, target.texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &target.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "[RenderTarget::create] Incomplete framebuffer (0x" << std::hex << status << std::dec << ")" << std::endl;
+		deleteRenderTarget(target);
+		return false;
+	}
+
+	target.width = width;
+	target.height = height;
+	target.format = format;
+
+	return true;
+}
+
+void deleteRenderTarget(renderTarget& target) {
+	if (target.fbo > 0) {
+		glDeleteFramebuffers(1, &target.fbo);
+	}
+
+	if (target.texture > 0) {
+		glDeleteTextures(1, &target.texture);
+	}
+
+	target = renderTarget{};
+}
+
+bool acquireRenderTarget(renderTargetPool& pool, renderTarget& target, GLuint width, GLuint height, GLenum format) {
+	releaseRenderTarget(pool, target);
+
+	// most recently released first : the most likely to be still resident
+	for (auto it = pool.available.rbegin(); it != pool.available.rend(); ++it) {
+		if (it->width == width && it->height == height && it->format == format) {
+			target = *it;
+			pool.available.erase(std::next(it).base());
+			pool.reused++;
+			return true;
+		}
+	}
+
+	if (!createRenderTarget(target, width, height, format)) {
+		return false;
+	}
+
+	pool.created++;
+
+	return true;
+}
+
+void releaseRenderTarget(renderTargetPool& pool, renderTarget& target) {
+	if (target.fbo == 0) {
+		return;
+	}
+
+	pool.available.push_back(target);
+	target = renderTarget{};
+
+	while (pool.available.size() > RENDER_TARGET_POOL_SIZE) {
+		deleteRenderTarget(pool.available.front());
+		pool.available.erase(pool.available.begin());
+	}
+}
+
+void clearRenderTargetPool(renderTargetPool& pool) {
+	for (renderTarget& target : pool.available) {
+		deleteRenderTarget(target);
+	}
+
+	pool.available.clear();
+}
@@ -0,0 +1,317 @@
+/**
+ * @author NoxFly
+ */
+
+#include "session.hpp"
+
+#include <cstring>
+#include <iostream>
+
+// record type of a frame, after the event types
+static const uint8_t SESSION_FRAME = 0;
+
+// fixed-size fields are written in the byte order of the machine : sessions are not meant to be portable
+template <typename T>
+static void writeValue(std::ostream& out, T value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool readValue(std::istream& in, T& value) {
+	return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+static void writeDoubleDouble(std::ostream& out, const doubleDouble& value) {
+	writeValue(out, value.hi);
+	writeValue(out, value.lo);
+}
+
+static bool readDoubleDouble(std::istream& in, doubleDouble& value) {
+	return readValue(in, value.hi) && readValue(in, value.lo);
+}
+
+
+SessionRecorder::SessionRecorder() :
+	m_file(),
+	m_path(),
+	m_frames(0)
+{
+}
+
+SessionRecorder::~SessionRecorder() {
+	stop();
+}
+
+bool SessionRecorder::start(const std::string& path, const sessionState& state) {
+	stop();
+
+	m_file.open(path, std::ios::binary | std::ios::trunc);
+
+	if (!m_file) {
+		std::cerr << "[Session] Failed to open " << path << std::endl;
+		return false;
+	}
+
+	m_file.write(SESSION_MAGIC, std::strlen(SESSION_MAGIC));
+	writeValue<uint16_t>(m_file, SESSION_VERSION);
+
+	writeValue<uint16_t>(m_file, (uint16_t)state.shaderName.size());
+	m_file.write(state.shaderName.data(), state.shaderName.size());
+
+	writeValue(m_file, state.width);
+	writeValue(m_file, state.height);
+	writeDoubleDouble(m_file, state.centerX);
+	writeDoubleDouble(m_file, state.centerY);
+	writeValue(m_file, state.zoom);
+	writeValue(m_file, state.increment);
+	writeValue(m_file, state.mode);
+	writeValue(m_file, state.flagsMask);
+	writeValue(m_file, state.keyMask);
+	writeValue(m_file, state.mouseMask);
+	writeValue(m_file, state.zooming);
+	writeValue(m_file, state.panX);
+	writeValue(m_file, state.panY);
+	writeValue(m_file, state.mouseX);
+	writeValue(m_file, state.mouseY);
+
+	m_path = path;
+	m_frames = 0;
+
+	return true;
+}
+
+void SessionRecorder::stop() {
+	if (!m_file.is_open()) {
+		return;
+	}
+
+	const bool success = (bool)m_file.flush();
+
+	m_file.close();
+
+	if (success) {
+		std::cout << "[Session] " << m_frames << " frames recorded to " << m_path << std::endl;
+	}
+	else {
+		std::cerr << "[Session] Failed to write " << m_path << std::endl;
+	}
+}
+
+bool SessionRecorder::isRecording() const {
+	return m_file.is_open();
+}
+
+void SessionRecorder::key(int key, int scancode, int action, int mods) {
+	if (!isRecording()) {
+		return;
+	}
+
+	writeValue<uint8_t>(m_file, SESSION_KEY);
+	writeValue<int16_t>(m_file, (int16_t)key);
+	writeValue<int32_t>(m_file, scancode);
+	writeValue<uint8_t>(m_file, (uint8_t)action);
+	writeValue<uint8_t>(m_file, (uint8_t)mods);
+}
+
+void SessionRecorder::mouseButton(int button, int action, int mods) {
+	if (!isRecording()) {
+		return;
+	}
+
+	writeValue<uint8_t>(m_file, SESSION_MOUSE_BUTTON);
+	writeValue<uint8_t>(m_file, (uint8_t)button);
+	writeValue<uint8_t>(m_file, (uint8_t)action);
+	writeValue<uint8_t>(m_file, (uint8_t)mods);
+}
+
+void SessionRecorder::mouseMove(double x, double y) {
+	if (!isRecording()) {
+		return;
+	}
+
+	writeValue<uint8_t>(m_file, SESSION_MOUSE_MOVE);
+	writeValue(m_file, x);
+	writeValue(m_file, y);
+}
+
+void SessionRecorder::frame(double time, float delta) {
+	if (!isRecording()) {
+		return;
+	}
+
+	writeValue<uint8_t>(m_file, SESSION_FRAME);
+	writeValue(m_file, time);
+	writeValue(m_file, delta);
+
+	m_frames++;
+}
+
+unsigned long long SessionRecorder::getFrameCount() const {
+	return m_frames;
+}
+
+
+SessionPlayer::SessionPlayer() :
+	m_state{},
+	m_frames(),
+	m_next(0),
+	m_replaying(false)
+{
+}
+
+bool SessionPlayer::open(const std::string& path) {
+	stop();
+
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file) {
+		std::cerr << "[Session] Failed to open " << path << std::endl;
+		return false;
+	}
+
+	char magic[sizeof(SESSION_MAGIC) - 1];
+	uint16_t version = 0;
+
+	if (!file.read(magic, sizeof(magic))
+		|| std::memcmp(magic, SESSION_MAGIC, sizeof(magic)) != 0
+		|| !readValue(file, version)
+	) {
+		std::cerr << "[Session] " << path << " is not a session file" << std::endl;
+		return false;
+	}
+
+	if (version != SESSION_VERSION) {
+		std::cerr << "[Session] Unsupported version " << version << " of " << path << std::endl;
+		return false;
+	}
+
+	sessionState state;
+	uint16_t nameLength = 0;
+
+	bool success = readValue(file, nameLength);
+
+	if (success) {
+		state.shaderName.resize(nameLength);
+		success = (bool)file.read(&state.shaderName[0], nameLength);
+	}
+
+	success = success
+		&& readValue(file, state.width)
+		&& readValue(file, state.height)
+		&& readDoubleDouble(file, state.centerX)
+		&& readDoubleDouble(file, state.centerY)
+		&& readValue(file, state.zoom)
+		&& readValue(file, state.increment)
+		&& readValue(file, state.mode)
+		&& readValue(file, state.flagsMask)
+		&& readValue(file, state.keyMask)
+		&& readValue(file, state.mouseMask)
+		&& readValue(file, state.zooming)
+		&& readValue(file, state.panX)
+		&& readValue(file, state.panY)
+		&& readValue(file, state.mouseX)
+		&& readValue(file, state.mouseY);
+
+	if (!success) {
+		std::cerr << "[Session] Truncated header in " << path << std::endl;
+		return false;
+	}
+
+	std::vector<sessionFrame> frames;
+	sessionFrame current;
+	uint8_t type;
+
+	while (readValue(file, type)) {
+		sessionEvent event;
+		event.type = (sessionEventType)type;
+
+		switch (type) {
+			case SESSION_FRAME:
+				success = readValue(file, current.time) && readValue(file, current.delta);
+
+				if (success) {
+					frames.push_back(std::move(current));
+					current = {};
+				}
+				break;
+
+			case SESSION_KEY: {
+				int16_t key;
+				uint8_t action, mods;
+
+				success = readValue(file, key) && readValue(file, event.scancode) && readValue(file, action) && readValue(file, mods);
+
+				event.key = key;
+				event.action = action;
+				event.mods = mods;
+				break;
+			}
+
+			case SESSION_MOUSE_BUTTON: {
+				uint8_t button, action, mods;
+
+				success = readValue(file, button) && readValue(file, action) && readValue(file, mods);
+
+				event.key = button;
+				event.action = action;
+				event.mods = mods;
+				break;
+			}
+
+			case SESSION_MOUSE_MOVE:
+				success = readValue(file, event.x) && readValue(file, event.y);
+				break;
+
+			default:
+				std::cerr << "[Session] Unknown record " << (int)type << " in " << path << std::endl;
+				return false;
+		}
+
+		// a recording cut short (crash, kill) is still replayable up to its last complete frame
+		if (!success) {
+			std::cerr << "[Session] " << path << " is truncated after " << frames.size() << " frames" << std::endl;
+			break;
+		}
+
+		if (type != SESSION_FRAME) {
+			current.events.push_back(event);
+		}
+	}
+
+	m_state = std::move(state);
+	m_frames = std::move(frames);
+	m_next = 0;
+	m_replaying = true;
+
+	return true;
+}
+
+void SessionPlayer::stop() {
+	m_replaying = false;
+}
+
+bool SessionPlayer::isReplaying() const {
+	return m_replaying;
+}
+
+bool SessionPlayer::nextFrame(sessionFrame& frame) {
+	if (!m_replaying || m_next >= m_frames.size()) {
+		m_replaying = false;
+		return false;
+	}
+
+	frame = m_frames[m_next++];
+	return true;
+}
+
+const sessionState& SessionPlayer::getState() const {
+	return m_state;
+}
+
+size_t SessionPlayer::getFrameCount() const {
+	return m_frames.size();
+}
+
+size_t SessionPlayer::getCurrentFrame() const {
+	return m_next;
+}
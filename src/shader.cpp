@@ -3,6 +3,14 @@
  */
 
 #include <shader.hpp>
+#include <programCache.hpp>
+#include <preprocessor.hpp>
+#include <bufferPass.hpp>
+#include <textureChannel.hpp>
+#include <referenceOrbit.hpp>
+#include <trace.hpp>
+
+#include <algorithm>
 
 std::string loadShaderFromFile(const char* shaderFilePath) {
     std::string shaderCode;
@@ -22,116 +30,11 @@ std::string loadShaderFromFile(const char* shaderFilePath) {
     return shaderCode;
 }
 
-bool getDependencyContent(const std::string& dependencyPath, std::string& dependencyContent) {
-    const std::string depPath = (dependencyPath.front() == '/'
-        ? dependencyPath
-        : "res/shaders/" + dependencyPath
-        ) + ".glsl";
-
-    std::ifstream depFile;
-
-    depFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    // do not use try/catch as it is Shader::readAndPrecomputeFile that is treating errors.
-    // if it throws here, then the caller will receive that error.
-
-    // open files
-    depFile.open(depPath);
-
-    if (!depFile.is_open()) {
-        return false;
-    }
-
-    std::stringstream depStream;
-
-    depStream << depFile.rdbuf();
-
-    depFile.close();
-
-    dependencyContent = depStream.str();
-
-    return true;
-}
-
 bool readAndPrecomputeFile(const std::string& filepath, std::string& shaderContent) {
-    std::ifstream shaderFile;
-
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try {
-        // open files
-        shaderFile.open(filepath);
-
-        if (!shaderFile.is_open()) {
-            std::cerr << "[LoadShader] Failed to open file. Maybe it does not exist, or wrong access rights." << std::endl;
-            return false;
-        }
-
-        std::string lineBuffer;
-
-        // ENHANCEMENT : for scaling, could be defined by rules and splitted and managed by an external entity
-        const std::string includeIdentifier = "#include";
-        const auto includeIdSize = includeIdentifier.size();
+    TRACE_SCOPE("preprocess");
 
-        const std::string versionIdentifier = "#version";
-
-        while (std::getline(shaderFile, lineBuffer)) {
-            auto identifierIdx = lineBuffer.find(includeIdentifier);
-
-            if (identifierIdx != lineBuffer.npos) {
-                lineBuffer.erase(0, identifierIdx + includeIdSize);
-                lineBuffer = trim(lineBuffer);
-
-                // not form of '#include <>' with a character between tags
-                if (lineBuffer.size() < 3 || lineBuffer.front() != '<' || lineBuffer.back() != '>') {
-                    std::cerr << "[LoadShader] Malformed syntax for include directive." << std::endl;
-                }
-
-                const std::string depPath = lineBuffer.substr(1, lineBuffer.size() - 2);
-                lineBuffer = "";
-
-                if (!getDependencyContent(depPath, lineBuffer)) {
-                    std::cerr << "[LoadShader] Failed to import dependency (" + depPath + ")";
-                    shaderFile.close();
-                    return false;
-                }
-            }
-            else if ((identifierIdx = lineBuffer.find(versionIdentifier)) != lineBuffer.npos) {
-                continue;
-            }
-
-            shaderContent += lineBuffer + '\n';
-        }
-
-        // close file handlers
-        shaderFile.close();
-
-        return true;
-    }
-
-    catch (std::ifstream::failure const& e) {
-        if (e.code().value() == 1 && shaderFile.is_open()) {
-            shaderFile.close();
-            return true;
-        }
-        
-#ifdef _DEBUG
-        //std::cerr << "[LoadShader] Something went wrong (ifstream failure) : " << e.what() << std::endl;
-#endif
-        return false;
-    }
-
-    catch (std::runtime_error const& e) {
-        const std::string what = e.what();
-
-#ifdef _DEBUG
-        //std::cerr
-        //    << "[LoadShader] Failed to read and parse file "
-        //    << filepath  << " : " << what
-        //    << std::endl;
-#endif
-        return false;
-    }
+    // includes are expanded (and cached) by the preprocessor
+    return preprocessShader(filepath, shaderContent);
 }
 
 bool checkCompileErrors(GLuint& shader, const std::string& type) {
@@ -143,7 +46,7 @@ bool checkCompileErrors(GLuint& shader, const std::string& type) {
 
         if (success != GL_TRUE) {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::string msg = infoLog;
+            std::string msg = mapShaderLog(infoLog);
             std::cerr << "[Shader::checkCompileErrors] Shader compilation error of type: " << type << "\n" + msg << std::endl;
             return false;
         }
@@ -154,7 +57,7 @@ bool checkCompileErrors(GLuint& shader, const std::string& type) {
 
         if (success != GL_TRUE) {
             glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::string msg = infoLog;
+            std::string msg = mapShaderLog(infoLog);
             std::cerr << "[Shader::checkCompileErrors] Program linking error of type: " << type << "\n" << msg << std::endl;
             return false;
         }
@@ -164,54 +67,115 @@ bool checkCompileErrors(GLuint& shader, const std::string& type) {
 }
 
 
-bool compileShader(GLuint& shader, const std::string& type, const std::string& filepath) {
-    GLenum shaderType = type == "VERTEX" ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
+/**
+ * GLSL version matching the current context, capped to 460.
+ * Software rasterizers like llvmpipe only expose 4.5.
+ */
+std::string getGLSLVersion() {
+    GLint major = 0, minor = 0;
 
-    std::string shaderCode;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+    const int version = std::min(major * 100 + minor * 10, 460);
+
+    return std::to_string(version < 330 ? 460 : version);
+}
+
+/**
+ * Layout mirrored by globalsBlock.
+ */
+static const std::string globalsSource = "layout(std140, binding = " + std::to_string(GLOBALS_BINDING) + R"END() uniform Globals {
+                mat4 MVP;
+                mat4 M;
+                mat4 V;
+                mat4 P;
+                vec2 ivMouse;
+                vec2 fvCenter;
+                vec2 uvResolution;
+                float fTime;
+                float fDelta;
+                float fRatio;
+                float fZoom;
+                int iIncrement;
+                int iMode;
+                int iMouseMask;
+                int iKeyMask;
+                int iFlagsMask;
+                float fRenderScale;
+                int iFrame;
+                int iDeepZoom;
+                vec2 fvJitter;
+                vec2 fvDeepOffset;
+                vec2 fvCenterLo;
+                float fZoomLo;
+                float fTimeLo;
+                float fTimeWrapped;
+            };)END";
+
+/**
+ * Buffers of the multi-pass shaders (see bufferPass.hpp) and image inputs (see textureChannel.hpp), on fixed texture units.
+ */
+static std::string buildSamplersSource() {
+    std::string source;
+
+    for (int i = 0; i < MAX_BUFFER_PASSES; i++) {
+        source += "layout(binding = " + std::to_string(BUFFER_TEXTURE_UNIT + i) + ") uniform sampler2D sBuffer" + (char)('A' + i) + ";\n";
+    }
+
+    for (int i = 0; i < MAX_TEXTURE_CHANNELS; i++) {
+        source += "layout(binding = " + std::to_string(CHANNEL_TEXTURE_UNIT + i) + ") uniform sampler2D iChannel" + std::to_string(i) + ";\n";
+    }
+
+    return source;
+}
+
+static const std::string samplersSource = buildSamplersSource();
+
+/**
+ * Reference orbit of the deep zoom (see referenceOrbit.hpp), only filled when iDeepZoom is set.
+ */
+static const std::string orbitSource = "layout(std430, binding = " + std::to_string(REFERENCE_ORBIT_BINDING) + R"END() readonly buffer ReferenceOrbit {
+                int iOrbitLength;
+                vec2 vOrbit[];
+            };)END";
+
+bool buildShaderSource(const std::string& type, const std::string& filepath, std::string& shaderCode) {
 
     if (type == "VERTEX") {
         shaderCode = R"END(
-            #version 460 core
+            #version @VERSION core
 
             in vec3 in_Vertex;
 
             out vec2 fragCoord;
 
-            uniform mat4 MVP;
+            @GLOBALS
 
             void main()
             {
-	            fragCoord = vec2(in_Vertex.x, in_Vertex.y);
+	            // in pixels of the internal resolution
+	            fragCoord = vec2(in_Vertex.x, in_Vertex.y) * fRenderScale + fvJitter;
 	            gl_Position = MVP * vec4(in_Vertex, 1.0);
             }
         )END";
     }
     else {
         shaderCode = R"END(
-            #version 460 core
+            #version @VERSION core
 
             in vec2 fragCoord;
 
-            uniform mat4 MVP;
-            uniform mat4 M;
-			uniform mat4 V;
-			uniform mat4 P;
-            uniform vec2 ivMouse;
-            uniform vec2 fvCenter;
-            uniform vec2 uvResolution;
-            uniform float fTime;
-            uniform float fDelta;
-            uniform float fRatio;
-            uniform float fZoom;
-            uniform int iIncrement;
+            @GLOBALS
 
-            uniform int iMode;
-
-            uniform int vbMousePressed[3];
-            uniform int vbKeyPressed[4];
-            uniform int vbFlags[10];
+            @SAMPLERS
 
+            @ORBIT
 
+            // unpacked from the masks of Globals before mainImage()
+            int vbMousePressed[3];
+            int vbKeyPressed[4];
+            int vbFlags[10];
 
             out vec4 fragColor;
 
@@ -219,6 +183,10 @@ bool compileShader(GLuint& shader, const std::string& type, const std::string& f
 
             void main()
             {
+	            for (int i = 0; i < 3; i++) vbMousePressed[i] = (iMouseMask >> i) & 1;
+	            for (int i = 0; i < 4; i++) vbKeyPressed[i] = (iKeyMask >> i) & 1;
+	            for (int i = 0; i < 10; i++) vbFlags[i] = (iFlagsMask >> i) & 1;
+
 	            mainImage();
             }
         )END";
@@ -229,9 +197,27 @@ bool compileShader(GLuint& shader, const std::string& type, const std::string& f
             return false;
         }
 
-        shaderCode = replace(shaderCode, "@GLSL", userCode);
+        // back to the prelude's numbering (source string 0) after the user code
+        shaderCode = replace(shaderCode, "@GLSL", userCode + "#line 1 0\n");
     }
 
+    shaderCode = replace(shaderCode, "@GLOBALS", globalsSource);
+    shaderCode = replace(shaderCode, "@SAMPLERS", samplersSource);
+    shaderCode = replace(shaderCode, "@ORBIT", orbitSource);
+    shaderCode = replace(shaderCode, "@VERSION", getGLSLVersion());
+
+    return true;
+}
+
+/**
+ * Hands the source to the driver without asking for the result :
+ * with parallel compilation, the driver keeps working while the caller moves on.
+ */
+static bool beginCompileShader(GLuint& shader, const std::string& type, const std::string& shaderCode) {
+    TRACE_SCOPE("compile");
+
+    GLenum shaderType = type == "VERTEX" ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
+
     const GLchar* GLshaderCode = shaderCode.c_str();
 
     // 2. compile shaders
@@ -245,6 +231,49 @@ bool compileShader(GLuint& shader, const std::string& type, const std::string& f
     glShaderSource(shader, 1, &GLshaderCode, NULL);
     glCompileShader(shader);
 
+    return true;
+}
+
+static void beginLinkShader(shader& shader) {
+    TRACE_SCOPE("link");
+
+    shader.id = glCreateProgram();
+    glAttachShader(shader.id, shader.vertexId);
+    glAttachShader(shader.id, shader.fragmentId);
+
+    // keep the binary available for the program cache
+    glProgramParameteri(shader.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glLinkProgram(shader.id);
+}
+
+void specializeShaderSource(std::string& fragmentSource, const shaderSpecialization& specialization) {
+    if (specialization.empty()) {
+        return;
+    }
+
+    std::string defines = "\n";
+
+    for (const auto& [uniform, value] : specialization) {
+        // parenthesized when negative : "x-iIncrement" must not become "x--3"
+        const std::string constant = value < 0 ? "(" + std::to_string(value) + ")" : std::to_string(value);
+
+        defines += "#define " + uniform + " " + constant + "\n";
+    }
+
+    // the block members must keep their names, only the code after it sees the constants
+    const size_t pos = fragmentSource.find(globalsSource);
+
+    if (pos != std::string::npos) {
+        fragmentSource.insert(pos + globalsSource.size(), defines);
+    }
+}
+
+bool compileShaderSource(GLuint& shader, const std::string& type, const std::string& shaderCode) {
+    if (!beginCompileShader(shader, type, shaderCode)) {
+        return false;
+    }
+
     if (!checkCompileErrors(shader, type)) {
         glDeleteShader(shader);
         return false;
@@ -253,6 +282,31 @@ bool compileShader(GLuint& shader, const std::string& type, const std::string& f
     return true;
 }
 
+bool compileShader(GLuint& shader, const std::string& type, const std::string& filepath) {
+    std::string shaderCode;
+
+    if (!buildShaderSource(type, filepath, shaderCode)) {
+        return false;
+    }
+
+    return compileShaderSource(shader, type, shaderCode);
+}
+
+bool linkShader(shader& shader) {
+    beginLinkShader(shader);
+
+    // delete the shaders as they're linked into our program now and no longer necessary
+    //glDeleteShader(shader.vertexId);
+    //glDeleteShader(shader.fragmentId);
+
+    if (!checkCompileErrors(shader.id, "PROGRAM")) {
+        deleteShader(shader);
+        return false;
+    }
+
+    return true;
+}
+
 void deleteShader(shader& shader) {
     if (glIsProgram(shader.id) == GL_TRUE) {
         glDeleteProgram(shader.id);
@@ -270,57 +324,236 @@ void deleteShader(shader& shader) {
     }
 }
 
-bool loadShader(shader& shader, const std::string& name) {
+static bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool readsIdentifiers(const std::string& fragmentSource, const std::vector<std::string>& identifiers) {
+    // the user code sits between the declarations of the prelude and its main(), which reads every mask
+    const std::string begin = "out vec4 fragColor;";
+    const std::string end = "void main()";
+
+    size_t pos = fragmentSource.find(begin);
+    pos = pos == std::string::npos ? 0 : pos + begin.size();
+
+    const size_t mainPos = fragmentSource.rfind(end);
+    const size_t size = mainPos == std::string::npos || mainPos < pos ? fragmentSource.size() : mainPos;
+
+    while (pos < size) {
+        const char c = fragmentSource[pos];
+
+        // comments
+        if (c == '/' && pos + 1 < size && fragmentSource[pos + 1] == '/') {
+            pos = fragmentSource.find('\n', pos);
+            continue;
+        }
+
+        if (c == '/' && pos + 1 < size && fragmentSource[pos + 1] == '*') {
+            pos = fragmentSource.find("*/", pos + 2);
+            pos = pos == std::string::npos ? size : pos + 2;
+            continue;
+        }
+
+        if (!isIdentifierChar(c)) {
+            pos++;
+            continue;
+        }
+
+        const size_t start = pos;
+
+        while (pos < size && isIdentifierChar(fragmentSource[pos])) {
+            pos++;
+        }
+
+        const std::string identifier = fragmentSource.substr(start, pos - start);
+
+        if (std::find(identifiers.begin(), identifiers.end(), identifier) != identifiers.end()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void enableParallelShaderCompile() {
+    // let the driver pick its number of threads
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+}
+
+bool shaderSourceKey(const std::string& name, uint64_t& key) {
+    std::string vertexSource, fragmentSource;
+
+    if (!buildShaderSource("VERTEX", name, vertexSource) || !buildShaderSource("FRAGMENT", name, fragmentSource)) {
+        return false;
+    }
+
+    key = programCacheKey(vertexSource, fragmentSource);
+
+    return true;
+}
+
+bool beginLoadShader(pendingShader& pending, const std::string& name, const shaderSpecialization& specialization) {
+    shader& shader = pending.program;
+    std::string vertexSource, fragmentSource;
+
+    if (!buildShaderSource("VERTEX", name, vertexSource) || !buildShaderSource("FRAGMENT", name, fragmentSource)) {
+        return false;
+    }
+
+    shader.animated = readsIdentifiers(fragmentSource, { "fTime", "fTimeLo", "fTimeWrapped", "fDelta", "iFrame" });
+    shader.readsMouse = readsIdentifiers(fragmentSource, { "ivMouse", "vbMousePressed", "iMouseMask" });
+    shader.deepZoom = readsIdentifiers(fragmentSource, { "iDeepZoom" });
+
+    // a variant behaves like the generic program : the flags above come from the user code only
+    specializeShaderSource(fragmentSource, specialization);
+
+    shader.sourceKey = programCacheKey(vertexSource, fragmentSource);
+
+    pending.cached = loadCachedProgram(shader.id, shader.sourceKey);
+
+    if (pending.cached) {
+        // no shader objects : the program comes straight from its binary
+        shader.vertexId = 0;
+        shader.fragmentId = 0;
+        return true;
+    }
+
     // Compile vertex shader and fragment shader
-    if (!compileShader(shader.vertexId, "VERTEX", name)) {
+    if (!beginCompileShader(shader.vertexId, "VERTEX", vertexSource)) {
         return false;
     }
 
-    if (!compileShader(shader.fragmentId, "FRAGMENT", name)) {
+    if (!beginCompileShader(shader.fragmentId, "FRAGMENT", fragmentSource)) {
         glDeleteShader(shader.vertexId);
         return false;
     }
 
-    // shader Program
-    shader.id = glCreateProgram();
-    glAttachShader(shader.id, shader.vertexId);
-    glAttachShader(shader.id, shader.fragmentId);
+    // shader Program, linked as soon as the driver is done with the stages
+    beginLinkShader(shader);
 
-    glLinkProgram(shader.id);
+    return true;
+}
 
-    // delete the shaders as they're linked into our program now and no longer necessary
-    //glDeleteShader(shader.vertexId);
-    //glDeleteShader(shader.fragmentId);
+bool isShaderLoaded(const pendingShader& pending) {
+    if (pending.cached || (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile)) {
+        return true;
+    }
 
-    if (!checkCompileErrors(shader.id, "PROGRAM")) {
-        deleteShader(shader);
-        return false;
+    GLint completed = GL_FALSE;
+    glGetProgramiv(pending.program.id, GL_COMPLETION_STATUS_KHR, &completed);
+
+    return completed == GL_TRUE;
+}
+
+bool finishLoadShader(pendingShader& pending, shader& shader) {
+    TRACE_SCOPE("finish shader");
+
+    struct shader program = pending.program;
+    const bool cached = pending.cached;
+
+    pending = {};
+
+    if (!cached) {
+        // waits for the driver if it is still compiling
+        const bool compiled = checkCompileErrors(program.vertexId, "VERTEX") && checkCompileErrors(program.fragmentId, "FRAGMENT");
+
+        if (!compiled || !checkCompileErrors(program.id, "PROGRAM")) {
+            deleteShader(program);
+            return false;
+        }
+
+        storeCachedProgram(program.id, program.sourceKey);
     }
 
+    shader = program;
+
     return true;
 }
 
+bool loadShader(shader& shader, const std::string& name, const shaderSpecialization& specialization) {
+    pendingShader pending;
 
-bool replaceFragmentShader(shader& shader, const std::string& name) {
-    GLuint newFragmentId;
+    return beginLoadShader(pending, name, specialization) && finishLoadShader(pending, shader);
+}
 
-    if (!compileShader(newFragmentId, "FRAGMENT", name)) {
-		return false;
-	}
+static const std::vector<std::string> specializableUniforms{ "iMode", "iIncrement", "iDeepZoom", "iFlagsMask" };
 
-	glDetachShader(shader.id, shader.fragmentId);
-	glDeleteShader(shader.fragmentId);
+bool parseSpecialization(const std::string& name, std::vector<std::string>& uniforms) {
+    uniforms.clear();
 
-	glAttachShader(shader.id, newFragmentId);
+    for (const shaderDirective& directive : getShaderDirectives("res/shaders/" + name + ".frag")) {
+        if (directive.name != "specialize") {
+            continue;
+        }
 
-	glLinkProgram(shader.id);
+        const std::string location = directive.file + ":" + std::to_string(directive.line);
 
-    shader.fragmentId = newFragmentId;
+        if (directive.arguments.empty()) {
+            std::cerr << "[Specialize] Expected #specialize <uniform>... (" << location << ")" << std::endl;
+            return false;
+        }
 
-    if (!checkCompileErrors(shader.id, "PROGRAM")) {
-        deleteShader(shader);
-		return false;
-	}
+        for (const std::string& uniform : directive.arguments) {
+            if (std::find(specializableUniforms.begin(), specializableUniforms.end(), uniform) == specializableUniforms.end()) {
+                std::cerr << "[Specialize] " << uniform << " cannot be specialized, expected iMode, iIncrement, iDeepZoom or iFlagsMask (" << location << ")" << std::endl;
+                return false;
+            }
 
-	return true;
+            if (std::find(uniforms.begin(), uniforms.end(), uniform) == uniforms.end()) {
+                uniforms.push_back(uniform);
+            }
+        }
+    }
+
+    return true;
+}
+
+int getSpecializationValue(const globalsBlock& block, const std::string& uniform) {
+    if (uniform == "iMode") {
+        return block.mode;
+    }
+
+    if (uniform == "iIncrement") {
+        return block.increment;
+    }
+
+    if (uniform == "iDeepZoom") {
+        return block.deepZoom;
+    }
+
+    if (uniform == "iFlagsMask") {
+        return block.flagsMask;
+    }
+
+    return 0;
+}
+
+std::string specializationKey(const shaderSpecialization& specialization) {
+    std::string key;
+
+    for (const auto& [uniform, value] : specialization) {
+        key += (key.empty() ? "" : ",") + uniform + "=" + std::to_string(value);
+    }
+
+    return key;
+}
+
+
+bool replaceFragmentShader(shader& shader, const std::string& name) {
+    // built aside : the current program stays untouched if the new one fails
+    struct shader newShader{};
+
+    if (!loadShader(newShader, name)) {
+        return false;
+    }
+
+    deleteShader(shader);
+    shader = newShader;
+
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+/**
+ * @author NoxFly
+ */
+
+#include "shaderCompiler.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+ShaderCompiler::ShaderCompiler() :
+	m_nextId(1),
+	m_inProgress(0),
+	m_running(false)
+{
+}
+
+ShaderCompiler::~ShaderCompiler() {
+	stop();
+}
+
+bool ShaderCompiler::start(const std::function<bool()>& makeCurrent, const std::function<void()>& releaseCurrent) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_running) {
+			return true;
+		}
+	}
+
+	// a worker that could not bind its context has already returned
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = true;
+	}
+
+	m_thread = std::thread(&ShaderCompiler::work, this, makeCurrent, releaseCurrent);
+
+	return true;
+}
+
+void ShaderCompiler::stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_running = false;
+		m_jobs.clear();
+	}
+
+	m_condition.notify_all();
+
+	// joined even if the worker stopped by itself (no context) : a joinable thread cannot be destroyed
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+
+	// results never polled : their programs live in the shared namespace, free them here
+	for (compileResult& result : m_results) {
+		if (result.fence != nullptr) {
+			glDeleteSync(result.fence);
+		}
+
+		deleteShader(result.program);
+	}
+
+	m_results.clear();
+}
+
+bool ShaderCompiler::isRunning() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_running;
+}
+
+void ShaderCompiler::setNotifier(const std::function<void()>& notifier) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_notifier = notifier;
+}
+
+unsigned long long ShaderCompiler::request(const std::string& name) {
+	return enqueue({ name }, {}, true);
+}
+
+unsigned long long ShaderCompiler::request(const std::string& name, const shaderSpecialization& specialization) {
+	return enqueue({ name }, specialization, true);
+}
+
+unsigned long long ShaderCompiler::request(const std::vector<std::string>& names) {
+	return enqueue(names, {}, false);
+}
+
+unsigned long long ShaderCompiler::enqueue(const std::vector<std::string>& names, const shaderSpecialization& specialization, bool coalesce) {
+	unsigned long long id;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		id = m_nextId++;
+
+		// coalesce : only the latest request of a shader is worth compiling
+		if (coalesce) {
+			for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+				it = it->names == names && it->specialization == specialization ? m_jobs.erase(it) : it + 1;
+			}
+		}
+
+		m_jobs.push_back({ id, names, specialization });
+	}
+
+	m_condition.notify_one();
+
+	return id;
+}
+
+bool ShaderCompiler::poll(compileResult& result) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_results.empty()) {
+		return false;
+	}
+
+	compileResult& front = m_results.front();
+
+	if (front.fence != nullptr) {
+		const GLenum status = glClientWaitSync(front.fence, 0, 0);
+
+		if (status == GL_TIMEOUT_EXPIRED) {
+			return false;
+		}
+
+		glDeleteSync(front.fence);
+		front.fence = nullptr;
+	}
+
+	result = front;
+	m_results.pop_front();
+
+	return true;
+}
+
+bool ShaderCompiler::isBusy() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_jobs.empty() || m_inProgress > 0 || !m_results.empty();
+}
+
+void ShaderCompiler::work(std::function<bool()> makeCurrent, std::function<void()> releaseCurrent) {
+	setTraceThreadName("shader compiler");
+
+	if (!makeCurrent()) {
+		std::cerr << "[ShaderCompiler] Cannot bind the shared context, shaders will be compiled synchronously." << std::endl;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+		return;
+	}
+
+	enableParallelShaderCompile();
+
+	while (true) {
+		job current;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			m_condition.wait(lock, [this] { return !m_running || !m_jobs.empty(); });
+
+			if (!m_running) {
+				break;
+			}
+
+			current = m_jobs.front();
+			m_jobs.pop_front();
+			m_inProgress++;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		// everything is handed to the driver first, then collected
+		struct pending {
+			std::string name;
+			pendingShader shader;
+			bool started;
+		};
+
+		std::vector<pending> batch;
+		batch.reserve(current.names.size());
+
+		for (const std::string& name : current.names) {
+			batch.push_back({ name, {}, false });
+			batch.back().started = beginLoadShader(batch.back().shader, name, current.specialization);
+		}
+
+		while (!batch.empty()) {
+			// stopping : the rest of the batch is dropped
+			if (!isRunning()) {
+				for (pending& p : batch) {
+					deleteShader(p.shader.program);
+				}
+
+				break;
+			}
+
+			// the first finished one, or the oldest if none is (waits for it)
+			auto next = std::find_if(batch.begin(), batch.end(), [](const pending& p) {
+				return !p.started || isShaderLoaded(p.shader);
+			});
+
+			if (next == batch.end()) {
+				next = batch.begin();
+			}
+
+			compileResult result;
+			result.id = current.id;
+			result.name = next->name;
+			result.specialization = current.specialization;
+			result.success = next->started && finishLoadShader(next->shader, result.program);
+			result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			batch.erase(next);
+
+			if (result.success) {
+				// signaled once the driver is really done with the program
+				result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				glFlush();
+			}
+
+			std::function<void()> notifier;
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				m_results.push_back(result);
+				notifier = m_notifier;
+			}
+
+			if (notifier) {
+				notifier();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_inProgress--;
+		}
+	}
+
+	releaseCurrent();
+}
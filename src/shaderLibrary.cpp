@@ -0,0 +1,108 @@
+/**
+ * @author NoxFly
+ */
+
+#include "shaderLibrary.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+std::vector<std::string> listShaders(const std::string& folder) {
+	namespace fs = std::filesystem;
+
+	std::vector<std::string> names;
+	std::error_code ec;
+
+	for (fs::recursive_directory_iterator it(folder, ec), end; !ec && it != end; it.increment(ec)) {
+		const fs::path& path = it->path();
+
+		if (it->is_directory() && path.filename() == "buffers") {
+			it.disable_recursion_pending();
+			continue;
+		}
+
+		if (!it->is_regular_file() || path.extension() != ".frag") {
+			continue;
+		}
+
+		fs::path name = path.lexically_relative(folder);
+		name.replace_extension();
+
+		names.push_back(name.generic_string());
+	}
+
+	std::sort(names.begin(), names.end());
+
+	return names;
+}
+
+ShaderLibrary::ShaderLibrary(size_t capacity) :
+	m_entries(),
+	m_capacity(std::max<size_t>(capacity, 1)),
+	m_clock(0),
+	m_stats{}
+{
+}
+
+bool ShaderLibrary::take(const std::string& name, uint64_t sourceKey, shader& program) {
+	auto it = m_entries.find(name);
+
+	if (it == m_entries.end()) {
+		m_stats.misses++;
+		return false;
+	}
+
+	if (it->second.program.sourceKey != sourceKey) {
+		deleteShader(it->second.program);
+		m_entries.erase(it);
+		m_stats.stale++;
+		return false;
+	}
+
+	program = it->second.program;
+	m_entries.erase(it);
+	m_stats.hits++;
+
+	return true;
+}
+
+void ShaderLibrary::put(const std::string& name, const shader& program) {
+	auto it = m_entries.find(name);
+
+	if (it != m_entries.end()) {
+		deleteShader(it->second.program);
+		m_entries.erase(it);
+	}
+
+	while (m_entries.size() >= m_capacity) {
+		auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const auto& a, const auto& b) {
+			return a.second.lastUse < b.second.lastUse;
+		});
+
+		deleteShader(oldest->second.program);
+		m_entries.erase(oldest);
+		m_stats.evictions++;
+	}
+
+	m_entries[name] = { program, ++m_clock };
+}
+
+bool ShaderLibrary::contains(const std::string& name) const {
+	return m_entries.find(name) != m_entries.end();
+}
+
+size_t ShaderLibrary::size() const {
+	return m_entries.size();
+}
+
+void ShaderLibrary::clear() {
+	for (auto& [name, entry] : m_entries) {
+		deleteShader(entry.program);
+	}
+
+	m_entries.clear();
+}
+
+shaderLibraryStats ShaderLibrary::getStats() const {
+	return m_stats;
+}
@@ -0,0 +1,327 @@
+/**
+ * @author NoxFly
+ */
+
+#include <textureChannel.hpp>
+#include <preprocessor.hpp>
+#include <image.hpp>
+#include <trace.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+bool parseTextureChannels(const std::string& shaderName, std::vector<textureChannel>& channels) {
+	channels.clear();
+
+	bool declared[MAX_TEXTURE_CHANNELS] = {};
+
+	for (const shaderDirective& directive : getShaderDirectives("res/shaders/" + shaderName + ".frag")) {
+		if (directive.name != "channel") {
+			continue;
+		}
+
+		const std::string location = directive.file + ":" + std::to_string(directive.line);
+		const std::vector<std::string>& args = directive.arguments;
+
+		if (args.size() != 2 || args[0].size() != 1 || args[0][0] < '0' || args[0][0] >= '0' + MAX_TEXTURE_CHANNELS) {
+			std::cerr << "[Texture] Expected #channel <0-3> <path> (" << location << ")" << std::endl;
+			return false;
+		}
+
+		textureChannel channel;
+		channel.index = args[0][0] - '0';
+		channel.path = args[1];
+
+		if (declared[channel.index]) {
+			std::cerr << "[Texture] Channel " << args[0] << " declared twice (" << location << ")" << std::endl;
+			return false;
+		}
+
+		declared[channel.index] = true;
+		channels.push_back(channel);
+	}
+
+	std::sort(channels.begin(), channels.end(), [](const textureChannel& a, const textureChannel& b) {
+		return a.index < b.index;
+	});
+
+	return true;
+}
+
+TextureCache::TextureCache(ThreadPool& pool):
+	m_pool(pool),
+	m_notifier(),
+	m_entries(),
+	m_stats{}
+{}
+
+void TextureCache::setNotifier(std::function<void()> notifier) {
+	m_notifier = std::move(notifier);
+}
+
+void TextureCache::request(const std::string& path) {
+	const std::string file = std::string(TEXTURE_FOLDER) + "/" + path;
+
+	std::error_code ec;
+	const auto time = std::filesystem::last_write_time(file, ec);
+
+	if (ec) {
+		std::cerr << "[Texture] Cannot find " << file << std::endl;
+		return;
+	}
+
+	const long long mtime = (long long)time.time_since_epoch().count();
+
+	entry& texture = m_entries[path];
+
+	// its file is checked again by the next request
+	if (texture.decoding.valid() || texture.filling.valid()) {
+		return;
+	}
+
+	if (texture.mtime == mtime && (texture.texture != 0 || texture.failed)) {
+		m_stats.hits++;
+		return;
+	}
+
+	texture.mtime = mtime;
+	texture.failed = false;
+	texture.requested = clock::now();
+
+	const std::function<void()> notifier = m_notifier;
+
+	texture.decoding = m_pool.submit([file, notifier]() {
+		TRACE_SCOPE("decode texture");
+
+		const auto start = clock::now();
+
+		decodedImage image;
+		image.pixels = std::make_shared<std::vector<unsigned char>>();
+		image.ok = readPNG(file, *image.pixels, image.width, image.height);
+		image.milliseconds = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+		if (notifier) {
+			notifier();
+		}
+
+		return image;
+	});
+}
+
+GLuint TextureCache::get(const std::string& path) const {
+	auto it = m_entries.find(path);
+
+	return it != m_entries.end() ? it->second.texture : 0;
+}
+
+bool TextureCache::update(bool wait) {
+	bool changed = false;
+
+	for (auto& [path, texture] : m_entries) {
+		if (texture.decoding.valid()) {
+			if (!wait && texture.decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				continue;
+			}
+
+			texture.image = texture.decoding.get();
+
+			// readPNG() said why. The previous texture, if any, stays
+			if (!texture.image.ok || !mapBuffer(path, texture)) {
+				texture.image = {};
+				texture.failed = true;
+				continue;
+			}
+		}
+
+		if (texture.filling.valid()) {
+			if (!wait && texture.filling.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				continue;
+			}
+
+			changed = uploadTexture(path, texture, texture.filling.get()) || changed;
+		}
+	}
+
+	return changed;
+}
+
+bool TextureCache::mapBuffer(const std::string& path, entry& texture) {
+	const unsigned int width = texture.image.width;
+	const unsigned int height = texture.image.height;
+	const size_t stride = (size_t)width * 4;
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+	if (width > (unsigned int)maxSize || height > (unsigned int)maxSize) {
+		std::cerr << "[Texture] " << path << " is " << width << "x" << height << ", larger than the " << maxSize << " pixels the GPU allows" << std::endl;
+		return false;
+	}
+
+	glGenBuffers(1, &texture.pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, stride * height, nullptr, GL_STREAM_DRAW);
+
+	// a new buffer : nothing to synchronize with
+	unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stride * height,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (mapped == nullptr) {
+		std::cerr << "[Texture] Cannot map an upload buffer for " << path << std::endl;
+		glDeleteBuffers(1, &texture.pbo);
+		texture.pbo = 0;
+		return false;
+	}
+
+	// the job owns the pixels, they are freed once copied
+	std::shared_ptr<std::vector<unsigned char>> pixels = std::move(texture.image.pixels);
+	const std::function<void()> notifier = m_notifier;
+
+	texture.filling = m_pool.submit([mapped, pixels, stride, height, notifier]() {
+		TRACE_SCOPE("fill texture buffer");
+
+		const auto start = clock::now();
+
+		// bottom row first, as GL textures are
+		for (unsigned int y = 0; y < height; y++) {
+			std::memcpy(mapped + stride * (height - 1 - y), pixels->data() + stride * y, stride);
+		}
+
+		const double milliseconds = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+		if (notifier) {
+			notifier();
+		}
+
+		return milliseconds;
+	});
+
+	return true;
+}
+
+bool TextureCache::uploadTexture(const std::string& path, entry& texture, double fillTime) {
+	TRACE_SCOPE("upload texture");
+
+	const auto start = clock::now();
+
+	const unsigned int width = texture.image.width;
+	const unsigned int height = texture.image.height;
+	const GLsizei levels = 1 + (GLsizei)std::floor(std::log2((double)std::max(width, height)));
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.pbo);
+
+	// false if the content was lost meanwhile (e.g. a display mode change)
+	const bool unmapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	GLuint id = 0;
+
+	if (unmapped) {
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D, id);
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, height);
+
+		// from the bound buffer : the transfer runs on the GPU, asynchronously
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// the driver keeps the buffer alive until the transfer is done
+	glDeleteBuffers(1, &texture.pbo);
+	texture.pbo = 0;
+
+	const decodedImage image = texture.image;
+	texture.image = {};
+
+	if (!unmapped) {
+		std::cerr << "[Texture] The upload buffer of " << path << " was lost, it will be loaded again by the next reload" << std::endl;
+		texture.mtime = 0;
+		return false;
+	}
+
+	size_t bytes = 0;
+
+	for (GLsizei level = 0; level < levels; level++) {
+		bytes += (size_t)std::max(1u, width >> level) * std::max(1u, height >> level) * 4;
+	}
+
+	if (texture.texture != 0) {
+		glDeleteTextures(1, &texture.texture);
+	}
+
+	m_stats.bytes = m_stats.bytes - texture.bytes + bytes;
+	m_stats.loads++;
+
+	texture.texture = id;
+	texture.width = width;
+	texture.height = height;
+	texture.bytes = bytes;
+
+	const auto end = clock::now();
+	const textureCacheStats stats = getStats();
+
+	std::cout << "[Texture] " << path << " " << width << "x" << height << std::fixed << std::setprecision(1)
+		<< " : decode " << image.milliseconds << " ms, copy " << fillTime << " ms, upload "
+		<< std::chrono::duration<double, std::milli>(end - start).count() << " ms, ready "
+		<< std::chrono::duration<double, std::milli>(end - texture.requested).count() << " ms after the request ("
+		<< stats.textures << " texture(s), " << stats.bytes / (1024.0 * 1024.0) << " MB on the GPU)"
+		<< std::defaultfloat << std::endl;
+
+	return true;
+}
+
+bool TextureCache::isLoading() const {
+	return std::any_of(m_entries.begin(), m_entries.end(), [](const auto& it) {
+		return it.second.decoding.valid() || it.second.filling.valid();
+	});
+}
+
+textureCacheStats TextureCache::getStats() const {
+	textureCacheStats stats = m_stats;
+
+	stats.textures = std::count_if(m_entries.begin(), m_entries.end(), [](const auto& it) {
+		return it.second.texture != 0;
+	});
+
+	return stats;
+}
+
+void TextureCache::clear() {
+	for (auto& [path, texture] : m_entries) {
+		if (texture.decoding.valid()) {
+			texture.decoding.wait();
+		}
+
+		// the pool writes into the mapping until then
+		if (texture.filling.valid()) {
+			texture.filling.wait();
+		}
+
+		if (texture.pbo != 0) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &texture.pbo);
+		}
+
+		if (texture.texture != 0) {
+			glDeleteTextures(1, &texture.texture);
+		}
+	}
+
+	m_entries.clear();
+	m_stats = {};
+}
@@ -0,0 +1,121 @@
+/**
+ * @author NoxFly
+ */
+
+#include "threadPool.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threads) :
+	m_running(true)
+{
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 0; i < threads; i++) {
+		m_threads.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_condition.notify_all();
+
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+unsigned int ThreadPool::size() const {
+	return (unsigned int)m_threads.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+
+	m_condition.notify_one();
+}
+
+void ThreadPool::work() {
+	setTraceThreadName("pool worker");
+
+	while (true) {
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			m_condition.wait(lock, [this]() {
+				return !m_running || !m_jobs.empty();
+			});
+
+			if (m_jobs.empty()) {
+				return;
+			}
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+	if (count == 0) {
+		return;
+	}
+
+	struct state {
+		std::atomic<size_t> next{ 0 };
+		size_t done = 0;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	// shared with the helpers : one may only start after everything is done
+	auto shared = std::make_shared<state>();
+
+	auto run = [shared, count, &body]() {
+		size_t completed = 0;
+
+		for (size_t i = shared->next++; i < count; i = shared->next++) {
+			body(i);
+			completed++;
+		}
+
+		if (completed > 0) {
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			shared->done += completed;
+
+			if (shared->done == count) {
+				shared->finished.notify_all();
+			}
+		}
+	};
+
+	const size_t helpers = std::min(count - 1, m_threads.size());
+
+	for (size_t i = 0; i < helpers; i++) {
+		enqueue(run);
+	}
+
+	run();
+
+	// body is only referenced by helpers while indices remain, all taken by now
+	std::unique_lock<std::mutex> lock(shared->mutex);
+
+	shared->finished.wait(lock, [&shared, count]() {
+		return shared->done == count;
+	});
+}
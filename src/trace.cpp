@@ -0,0 +1,238 @@
+/**
+ * @author NoxFly
+ */
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum traceKind : uint8_t {
+	TRACE_ZONE,
+	TRACE_COUNTER
+};
+
+// atomics so the writer can read a ring while its thread keeps recording
+struct traceSlot {
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<int64_t> start{ 0 };
+	std::atomic<int64_t> end{ 0 };		// counters : the bits of the value
+	std::atomic<uint8_t> kind{ TRACE_ZONE };
+};
+
+struct traceRing {
+	std::unique_ptr<traceSlot[]> slots;
+	std::atomic<uint64_t> head{ 0 };	// events ever recorded, the next one goes to head % TRACE_RING_SIZE
+	unsigned int tid = 0;
+	std::string threadName;				// guarded by registryMutex
+};
+
+// a plain copy of a slot, once read
+struct traceEvent {
+	const char* name;
+	int64_t start;
+	int64_t end;
+	traceKind kind;
+};
+
+std::atomic<bool> traceEnabled(false);
+
+static const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+// rings outlive their thread : a finished job is still in the trace
+static std::mutex registryMutex;
+static std::vector<std::shared_ptr<traceRing>> rings;
+
+static thread_local traceRing* localRing = nullptr;
+static thread_local std::string localThreadName;
+
+void setTraceEnabled(bool enabled) {
+	traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t traceNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+static traceRing* getRing() {
+	if (localRing != nullptr) {
+		return localRing;
+	}
+
+	auto ring = std::make_shared<traceRing>();
+	ring->slots.reset(new traceSlot[TRACE_RING_SIZE]);
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	ring->tid = (unsigned int)rings.size() + 1;
+	ring->threadName = localThreadName.empty() ? "thread " + std::to_string(ring->tid) : localThreadName;
+
+	rings.push_back(ring);
+	localRing = ring.get();
+
+	return localRing;
+}
+
+static void record(traceKind kind, const char* name, int64_t start, int64_t end) {
+	traceRing* ring = getRing();
+
+	// single writer : only this thread moves the head
+	const uint64_t index = ring->head.load(std::memory_order_relaxed);
+	traceSlot& slot = ring->slots[index % TRACE_RING_SIZE];
+
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	slot.kind.store(kind, std::memory_order_relaxed);
+
+	ring->head.store(index + 1, std::memory_order_release);
+}
+
+void traceZone(const char* name, int64_t start, int64_t end) {
+	record(TRACE_ZONE, name, start, end);
+}
+
+void traceCounter(const char* name, double value) {
+	if (!isTraceEnabled()) {
+		return;
+	}
+
+	int64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const int64_t now = traceNow();
+
+	record(TRACE_COUNTER, name, now, bits);
+}
+
+void setTraceThreadName(const std::string& name) {
+	localThreadName = name;
+
+	if (localRing != nullptr) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		localRing->threadName = name;
+	}
+}
+
+/**
+ * The events of a ring, oldest first. Those its thread overwrote while they were copied are dropped.
+ */
+static std::vector<traceEvent> readRing(const traceRing& ring) {
+	const uint64_t head = ring.head.load(std::memory_order_acquire);
+	const uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+	std::vector<traceEvent> events;
+	events.reserve((size_t)(head - first));
+
+	for (uint64_t i = first; i < head; i++) {
+		const traceSlot& slot = ring.slots[i % TRACE_RING_SIZE];
+
+		events.push_back({
+			slot.name.load(std::memory_order_relaxed),
+			slot.start.load(std::memory_order_relaxed),
+			slot.end.load(std::memory_order_relaxed),
+			(traceKind)slot.kind.load(std::memory_order_relaxed)
+		});
+	}
+
+	const uint64_t after = ring.head.load(std::memory_order_acquire);
+
+	// the slot of event i is reused by event i + TRACE_RING_SIZE
+	// (event "after" may be half written already)
+	const uint64_t overwritten = after >= first + TRACE_RING_SIZE ? after - first - TRACE_RING_SIZE + 1 : 0;
+
+	events.erase(events.begin(), events.begin() + (size_t)std::min<uint64_t>(overwritten, events.size()));
+
+	return events;
+}
+
+static std::string escapeJson(const std::string& text) {
+	std::string escaped;
+
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+
+		escaped += c;
+	}
+
+	return escaped;
+}
+
+bool writeTrace(const std::string& path, double seconds) {
+	const int64_t now = traceNow();
+	const int64_t from = now - (int64_t)(seconds * 1e9);
+
+	std::vector<std::shared_ptr<traceRing>> snapshot;
+	std::vector<std::string> names;
+
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+
+		snapshot = rings;
+
+		for (const auto& ring : rings) {
+			names.push_back(ring->threadName);
+		}
+	}
+
+	std::ofstream out(path);
+
+	if (!out) {
+		std::cerr << "[Trace] Failed to open " << path << std::endl;
+		return false;
+	}
+
+	// timestamps in microseconds
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		<< "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ShaderPlayground\"}}"
+		<< std::fixed << std::setprecision(3);
+
+	unsigned long long count = 0;
+
+	for (size_t r = 0; r < snapshot.size(); r++) {
+		const traceRing& ring = *snapshot[r];
+
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring.tid
+			<< ",\"args\":{\"name\":\"" << escapeJson(names[r]) << "\"}}";
+
+		for (const traceEvent& event : readRing(ring)) {
+			if (event.name == nullptr || event.start < from) {
+				continue;
+			}
+
+			if (event.kind == TRACE_COUNTER) {
+				double value;
+				std::memcpy(&value, &event.end, sizeof(value));
+
+				out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << ring.tid
+					<< ",\"ts\":" << event.start / 1000.0 << ",\"args\":{\"value\":" << value << "}}";
+			}
+			else {
+				out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"playground\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring.tid
+					<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+			}
+
+			count++;
+		}
+	}
+
+	out << "\n]}\n";
+
+	if (!out) {
+		std::cerr << "[Trace] Failed to write " << path << std::endl;
+		return false;
+	}
+
+	std::cout << "[Trace] " << count << " events of the last " << seconds << " s written to " << path << std::endl;
+
+	return true;
+}
@@ -0,0 +1,123 @@
+/**
+ * @author NoxFly
+ */
+
+#include <uniformBuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+bool createUniformRing(uniformRing& ring, GLsizeiptr size) {
+	deleteUniformRing(ring);
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	ring.size = size;
+	ring.stride = (size + alignment - 1) / alignment * alignment;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &ring.buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+	glBufferStorage(GL_UNIFORM_BUFFER, ring.stride * UNIFORM_RING_SLOTS, nullptr, flags);
+
+	ring.mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, ring.stride * UNIFORM_RING_SLOTS, flags);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (ring.mapped == nullptr) {
+		std::cerr << "[UniformBuffer] Failed to map the uniform buffer" << std::endl;
+		deleteUniformRing(ring);
+		return false;
+	}
+
+	// every slot starts with everything to write
+	markUniformRing(ring, 0, size);
+
+	return true;
+}
+
+void deleteUniformRing(uniformRing& ring) {
+	for (GLsync& fence : ring.fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	if (ring.buffer > 0) {
+		if (ring.mapped != nullptr) {
+			glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+
+		glDeleteBuffers(1, &ring.buffer);
+	}
+
+	ring = uniformRing();
+}
+
+void markUniformRing(uniformRing& ring, GLsizeiptr offset, GLsizeiptr size) {
+	for (unsigned int i = 0; i < UNIFORM_RING_SLOTS; i++) {
+		if (ring.dirtyEnd[i] <= ring.dirtyBegin[i]) {
+			ring.dirtyBegin[i] = offset;
+			ring.dirtyEnd[i] = offset + size;
+		}
+		else {
+			ring.dirtyBegin[i] = std::min(ring.dirtyBegin[i], offset);
+			ring.dirtyEnd[i] = std::max(ring.dirtyEnd[i], offset + size);
+		}
+	}
+}
+
+void uploadUniformRing(uniformRing& ring, const void* data, GLuint binding) {
+	if (ring.mapped == nullptr) {
+		return;
+	}
+
+	ring.slot = (ring.slot + 1) % UNIFORM_RING_SLOTS;
+
+	const unsigned int slot = ring.slot;
+
+	// the GPU may still read this slot, from UNIFORM_RING_SLOTS frames ago
+	if (ring.fences[slot] != nullptr) {
+		GLenum status = glClientWaitSync(ring.fences[slot], 0, 0);
+
+		if (status == GL_TIMEOUT_EXPIRED) {
+			ring.stalls++;
+
+			do {
+				status = glClientWaitSync(ring.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			} while (status == GL_TIMEOUT_EXPIRED);
+		}
+
+		glDeleteSync(ring.fences[slot]);
+		ring.fences[slot] = nullptr;
+	}
+
+	if (ring.dirtyEnd[slot] > ring.dirtyBegin[slot]) {
+		const GLsizeiptr begin = ring.dirtyBegin[slot];
+
+		std::memcpy(ring.mapped + slot * ring.stride + begin, (const unsigned char*)data + begin, ring.dirtyEnd[slot] - begin);
+
+		ring.dirtyBegin[slot] = 0;
+		ring.dirtyEnd[slot] = 0;
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, ring.buffer, slot * ring.stride, ring.size);
+}
+
+void fenceUniformRing(uniformRing& ring) {
+	if (ring.mapped == nullptr) {
+		return;
+	}
+
+	if (ring.fences[ring.slot] != nullptr) {
+		glDeleteSync(ring.fences[ring.slot]);
+	}
+
+	ring.fences[ring.slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -31,5 +31,28 @@ std::string replace(const std::string& str, const std::string& find, const std::
 
     result.append(str, from, std::string::npos);
 
+    return result;
+}
+
+uint64_t hash64(std::string_view data, uint64_t seed) {
+    uint64_t hash = seed;
+
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+std::string toHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string result(16, '0');
+
+    for (int i = 15; i >= 0; i--) {
+        result[i] = digits[value & 0xF];
+        value >>= 4;
+    }
+
     return result;
 }
\ No newline at end of file